@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+#include <ngram/text2wfreq.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+/**
+ * Throughput benchmark for the counting stage.
+ *
+ * The input file ( res/sample.txt by default ) is concatenated --scale times
+ * into a temporary file, then each ngram type is counted once and the number
+ * of input tokens per second is reported, and the peak memory at the end.
+ * Runs with and without --expected-uniques show what growing the table costs.
+ *
+ * usage: ngram_bench [--in=sample.txt] [--scale=50] [--n=3] [--table=tst|hash]
+ *                    [--expected-uniques=K|auto]
+ */
+
+static bool makeScaledInput(const char *inFileName, const char *scaledFileName,
+                            int scale) {
+  FILE *in = fopen(inFileName, "rb");
+  if (in == NULL) {
+    fprintf(stderr, "ngram_bench - failed to open file %s\n", inFileName);
+    return false;
+  }
+  fseek(in, 0, SEEK_END);
+  long size = ftell(in);
+  fseek(in, 0, SEEK_SET);
+  char *content = (char *)malloc(size > 0 ? size : 1);
+  size_t bytesRead = fread(content, 1, size, in);
+  fclose(in);
+
+  FILE *out = fopen(scaledFileName, "wb");
+  if (out == NULL) {
+    fprintf(stderr, "ngram_bench - failed to create file %s\n",
+            scaledFileName);
+    free(content);
+    return false;
+  }
+  for (int i = 0; i < scale; i++) {
+    fwrite(content, 1, bytesRead, out);
+  }
+  fclose(out);
+  free(content);
+  return true;
+}
+
+template <class T>
+static void run(const char *name, int ngramN, const char *fileName,
+                const char *delimiters, const char *stopChars,
+                const NgramOptions &options) {
+  auto start = std::chrono::steady_clock::now();
+  T *ngrams = new T(ngramN, fileName, "", delimiters, stopChars, options);
+  auto end = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  double tokens = (double)ngrams->total(1);
+  printf("%-10s %12.0f tokens %8.3f s %12.0f tokens/s %10" PRId64 " unique\n",
+         name, tokens, seconds, seconds > 0 ? tokens / seconds : 0.0,
+         ngrams->count());
+  delete ngrams;
+}
+
+int main(int argc, char *argv[]) {
+  utf8_string inFileName = Config::getOptionValue("-in", argc, argv);
+  if (inFileName.isEmpty()) {
+    inFileName = "sample.txt";
+  }
+  int scale = 50;
+  utf8_string value = Config::getOptionValue("-scale", argc, argv);
+  if (value != "") {
+    sscanf(value.c_str(), "%d", &scale);
+  }
+  int ngramN = Config::DEFAULT_NGRAM_N;
+  value = Config::getOptionValue("-n", argc, argv);
+  if (value != "") {
+    sscanf(value.c_str(), "%d", &ngramN);
+  }
+
+  NgramOptions options;
+  value = Config::getOptionValue("-table", argc, argv);
+  if (value == "hash") {
+    options.tableType = Config::HASH_TABLE;
+  } else if (value == "tst") {
+    options.tableType = Config::TST_TABLE;
+  }
+  value = Config::getOptionValue("-expected-uniques", argc, argv);
+  if (value == "auto") {
+    options.sampleUniques = true;
+  } else if (value != "") {
+    long long expected = 0;
+    sscanf(value.c_str(), "%lld", &expected);
+    options.expectedUniques = (size_t)expected;
+  }
+
+  const char *scaledFileName = "ngram_bench_input.tmp";
+  if (!makeScaledInput(inFileName.c_str(), scaledFileName, scale)) {
+    return 1;
+  }
+  printf("input %s x %d, %d-grams, %s table\n", inFileName.c_str(), scale,
+         ngramN, options.tableType == Config::HASH_TABLE ? "hash" : "tst");
+  const char *delimiters = Config::getDefaultDelimiters();
+  const char *stopChars = Config::getDefaultStopChars();
+  run<WordNgrams>("word", ngramN, scaledFileName, delimiters, stopChars,
+                  options);
+  run<CharNgrams>("character", ngramN, scaledFileName, delimiters, stopChars,
+                  options);
+  run<ByteNgrams>("byte", ngramN, scaledFileName, "", "", options);
+  remove(scaledFileName);
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    // kilobytes on Linux
+    printf("peak memory %ld KB\n", usage.ru_maxrss);
+  }
+#endif
+  return 0;
+}
@@ -1,8 +1,10 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 
 #include <ngram/char_ngrams.h>
+#include <ngram/ngram_merger.h>
 #include <ngram/text2wfreq.h>
 
 /**
@@ -10,19 +12,97 @@
  */
 void Text2wfreq::showHelp() {
   printf("\nUsage: ngrams [options]\n");
-  printf("Compute all the word/char frequencies for the given text file.\n");
+  printf("       ngrams merge [options] count files\n");
+  printf("Compute all the word/char frequencies for the given text file, or "
+         "add up the\nfrequencies of ngram count files, text or binary, of "
+         "the same kind.\n");
   printf("Options:\n");
-  printf("--n=N			Number of ngrams, the default is %d-grams.\n",
-         Config::DEFAULT_NGRAM_N);
+  printf("--n=N			Number of ngrams, up to %d, the default is %d-grams.\n",
+         (int)INgrams::MAX_N, Config::DEFAULT_NGRAM_N);
   printf("--type=T		character, word or byte, the default is %s.\n",
          (int)Config::DEFAULT_NGRAM_TYPE == (int)Config::WORD_NGRAM
              ? "word"
              : (int)Config::DEFAULT_NGRAM_TYPE == (int)Config::CHAR_NGRAM
                    ? "character"
                    : "byte");
-  printf("--in=training files	default to stdin.\n");
-  printf("--out=output file	default to stdout. ( currently stdout only "
-         ")\n\n");
+  printf("--table=T		hash or tst ( ternary search tree ), the default is "
+         "%s.\n",
+         (int)Config::DEFAULT_TABLE_TYPE == (int)Config::HASH_TABLE ? "hash"
+                                                                    : "tst");
+  printf("--threads=K		count with K threads, each counting a chunk of a "
+         "file input\n			or a range of the input files, and sort "
+         "the output\n			with K threads, the default is 1.\n");
+  printf("--partitions=P		with --threads, split the table into P hash "
+         "partitions, each\n			filled by its own thread instead of "
+         "merging, the default is 1.\n			Not with --max-memory.\n");
+  printf("--top=K			output only the K most frequent ngrams of each N,\n"
+         "--top=K1,K2,...		or K1 1-grams, K2 2-grams and so on, 0 for all, "
+         "the\n			default is all.\n");
+  printf("--min-count=C		output only ngrams seen at least C times.\n");
+  printf("--max-memory=MB		prune the least frequent ngrams while counting "
+         "when the\n			table grows past MB megabytes, their counts "
+         "become\n			approximate. The default is no pruning.\n");
+  printf("--memory-limit=MB	spill the table to sorted run files in $TMPDIR "
+         "when it\n			grows past MB megabytes and merge them at "
+         "the end, counts\n			stay exact. Counts with one thread.\n");
+  printf("--format=text|binary	output ngram lines, or a binary ngram count "
+         "file with\n			sorted keys for lookups, the default is text. "
+         "--top\n			applies to text only.\n");
+  printf("--doc-boundaries	each input file is a document, no ngram spans "
+         "two files.\n");
+  printf("--approx=cms		count in a Count-Min Sketch of fixed size and keep "
+         "only the\n			most frequent ngrams of each N, their "
+         "counts are\n			approximate. Counts with one thread.\n");
+  printf("--sketch-width=W	counters per row of the sketch, the default is "
+         "%d.\n",
+         (int)NgramOptions().sketchWidth);
+  printf("--sketch-depth=D	rows of the sketch, the default is %d.\n",
+         NgramOptions().sketchDepth);
+  printf("--heavy-hitters=K	most frequent ngrams of each N kept with "
+         "--approx, the\n			default is %d.\n",
+         (int)NgramOptions().heavyHitters);
+  printf("--estimate-uniques	only estimate the unique ngrams of each N with "
+         "HyperLogLog,\n			in little time and memory, no "
+         "ngrams are output.\n");
+  printf("--uniques-precision=P	HyperLogLog registers are 2^P, from %d to "
+         "%d, the default\n			is %d for a standard error of "
+         "0.81%%.\n",
+         HyperLogLog::MIN_PRECISION, HyperLogLog::MAX_PRECISION,
+         NgramOptions().uniquesPrecision);
+  printf("--expected-uniques=K	size the table for K unique ngrams of all N up "
+         "front instead\n			of growing it, or auto to estimate "
+         "them from a sample of\n			the input files. Not "
+         "with --max-memory or --memory-limit.\n");
+  printf("--in=training files	files, glob patterns or @list for a file "
+         "listing one file\n			per line, default to "
+         "stdin.\n");
+  printf("--out=output file	default to stdout.\n\n");
+}
+
+/**
+ * merge the count files given as arguments after "merge"
+ */
+static int merge(Text2wfreq &tf, int argc, char *argv[]) {
+  // options start with '-', the other arguments are files
+  ngram_vector<char *> options;
+  ngram_vector<const char *> files;
+  options.add(argv[0]);
+  for (int i = 2; i < argc; i++) {
+    if (argv[i][0] == '-') {
+      options.add(argv[i]);
+    } else {
+      files.add(argv[i]);
+    }
+  }
+  if (files.count() == 0 ||
+      (options.count() > 1 && !tf.getOptions(options.count(), &options[0]))) {
+    tf.showHelp();
+    return 0;
+  }
+  NgramMerger merger(tf.getNgramOptions());
+  return merger.merge(&files[0], files.count(), tf.getOutFileName().c_str())
+             ? 0
+             : 1;
 }
 
 int main(int argc, char *argv[]) {
@@ -30,22 +110,35 @@ int main(int argc, char *argv[]) {
   time(&startTime);
   Text2wfreq tf;
 
+  if (argc > 1 && strcmp(argv[1], "merge") == 0) {
+    return merge(tf, argc, argv);
+  }
+
   if (tf.getOptions(argc, argv)) {
     // tf.printOptions();
   } else {
     tf.showHelp();
     return 0;
   }
-  INgrams *ngrams = NULL;
+  // the input files are counted into one table, with one vocabulary
+  Ngrams *ngrams = NULL;
   if (tf.getNgramType() == Config::WORD_NGRAM) { // word ngrams
-    ngrams = new WordNgrams(tf.getNgramN(), tf.getInFileName().c_str(),
-                            tf.getOutFileName().c_str());
+    ngrams = new WordNgrams(tf.getNgramN(), NULL, tf.getOutFileName().c_str(),
+                            Config::getDefaultDelimiters(),
+                            Config::getDefaultStopChars(),
+                            tf.getNgramOptions());
   } else if (tf.getNgramType() == Config::CHAR_NGRAM) { // char ngrams
-    ngrams = new CharNgrams(tf.getNgramN(), tf.getInFileName().c_str(),
-                            tf.getOutFileName().c_str());
+    ngrams = new CharNgrams(tf.getNgramN(), NULL, tf.getOutFileName().c_str(),
+                            Config::getDefaultDelimiters(),
+                            Config::getDefaultStopChars(),
+                            tf.getNgramOptions());
   } else if (tf.getNgramType() == Config::BYTE_NGRAM) { // byte ngrams
-    ngrams = new ByteNgrams(tf.getNgramN(), tf.getInFileName().c_str(),
-                            tf.getOutFileName().c_str());
+    ngrams = new ByteNgrams(tf.getNgramN(), NULL, tf.getOutFileName().c_str(),
+                            "", "", tf.getNgramOptions());
+  }
+  const ngram_vector<char *> &inFileNames = tf.getInFileNames();
+  if (ngrams && inFileNames.count() > 0) {
+    ngrams->addFiles(&inFileNames[0], inFileNames.count());
   }
 
   time_t midTime;
@@ -25,141 +25,81 @@ WebSite: http://www.cs.dal.ca/~zyu
 
 #include <ngram/byte_ngrams.h>
 
+#include <cinttypes>
+
 ByteNgrams::ByteNgrams(int newNgramN, const char *newInFileName,
                        const char *newOutFileName, const char *newDelimiters,
-                       const char *newStopChars)
+                       const char *newStopChars,
+                       const NgramOptions &newOptions)
     : Ngrams(newNgramN, newInFileName, newOutFileName, newDelimiters,
-             newStopChars) {
-  addTokens();
+             newStopChars, newOptions) {
+  this->enableDirectCounts(2);
+  if (newInFileName) {
+    addTokens();
+  }
 }
 
 ByteNgrams::~ByteNgrams() {}
 
-void ByteNgrams::addTokens() {
-  // get token string from input file
-  auto &inFileName = getInFileName();
-  FILE *fp = inFileName.length() > 0 ? fopen(inFileName.c_str(), "rb") : stdin;
-
-  if (fp == NULL) {
-    printf("ByteNgrams:addTokens - failed to open file %s\n",
-           inFileName.c_str());
-  } else {
-
-    int count = 0;
-    char c[3];
-    c[1] = 0;
-    c[2] = 0;
-    unsigned char buffer[1024 * 32];
-
-    while (true) {
-      size_t bytesRead = fread(buffer, 1, sizeof(buffer), fp);
-
-      for (size_t i = 0; i < bytesRead; i++) {
-        sprintf(c, "%02x", buffer[i]);
-        addToken(c);
-        count++;
-      }
-
-      if (bytesRead == 0) {
-        break;
-      }
-    }
-    // special processing need to be done, if less than NGRAM_N tokens in the
-    // whole input text.
-    if (count < this->getN()) {
-      preParse(count);
-    }
-
-    fclose(fp);
-  }
+void ByteNgrams::tokenize(const char *begin, const char *end) {
+  this->addByteTokens(begin, end);
 }
 
-void ByteNgrams::preParse(int count) {
-  TokenNode *p, *newHead;
-  p = newHead = head;
-  utf8_string ngram;
-  ngram.reserve(64);
-  while (newHead) {
-    p = newHead;
-    ngram.empty();
-    for (int i = 0; i < count; i++) {
-      ngram += p->token;
-      // printf("%d ngram %s.\n", i, ngram.c_str() );
-      this->addNgram(ngram.c_str(), i + 1);
-      if (p == tail) {
-        break;
-      }
-      p = p->next;
-    }
-    newHead = newHead->next;
-  }
-}
-void ByteNgrams::parse() {
-  TokenNode *p, *newHead;
-  p = newHead = head;
-  utf8_string ngram;
-  ngram.reserve(64);
-  while (newHead) {
-    int n = 0;
-    p = newHead;
-    ngram.empty();
-    while (p) {
-      ngram += p->token;
-      n++;
-      p = p->next;
-    }
-    // printf("%d ngram %s.\n", n, ngram.c_str() );
-    if (n > 0) {
-      this->addNgram(ngram.c_str(), n);
-    }
-    newHead = newHead->next;
-  }
-}
-
-void ByteNgrams::output() {
+void ByteNgrams::outputText() {
   int ngramN = this->getN();
+  OutputWriter out;
+  if (!out.open(getOutFileName().c_str())) {
+    printf("ByteNgrams:output - failed to open file %s\n",
+           getOutFileName().c_str());
+    return;
+  }
 
-  printf("BEGIN OUTPUT BYTE NGRAMS\n");
-  printf("Total %d unique ngrams in %d ngrams.\n", this->count(),
-         this->total());
-  fprintf(stderr, "Total %d unique ngrams in %d ngrams.\n", this->count(),
-          this->total());
+  out.write("BEGIN OUTPUT BYTE NGRAMS\n");
+  out.format("Total %" PRId64 " unique ngrams in %" PRId64 " ngrams.\n",
+             this->count(), this->total());
+  fprintf(stderr, "Total %" PRId64 " unique ngrams in %" PRId64 " ngrams.\n",
+          this->count(), this->total());
+  if (this->getPrunedCount()) {
+    out.format("Rare ngrams were pruned while counting, frequencies may be "
+               "up to %" PRId64 " too low.\n",
+               this->getPrunedCount());
+  }
+  this->writeApproximation(out);
 
   for (int i = 1; i <= ngramN; i++) {
-    // Get sorted item list
-    ngram_vector<NgramToken *> ngram_vector;
-    this->getNgrams(ngram_vector, i);
-
-    printf("\n%d-GRAMS ( Total %d unique ngrams in %d grams )\n", i,
-           this->count(i), this->total(i));
-    fprintf(stderr, "\n%d-GRAMS ( Total %d unique ngrams in %d grams )\n", i,
-            this->count(i), this->total(i));
-    printf("------------------------\n");
-
-    size_t count = ngram_vector.count();
-    ngram_vector.sort(INgrams::compareFunction);
-    for (unsigned j = 0; j < count; j++) {
-      NgramToken *ngramToken = ngram_vector[j];
-
-      printf("%s\t%d\n", ngramToken->ngram.c_str(),
-             ngramToken->value.frequency);
+    out.format("\n%d-GRAMS ( Total %" PRId64 " unique ngrams in %" PRId64
+               " grams )\n",
+               i, this->count(i), this->total(i));
+    fprintf(stderr,
+            "\n%d-GRAMS ( Total %" PRId64 " unique ngrams in %" PRId64
+            " grams )\n",
+            i, this->count(i), this->total(i));
+    out.write("------------------------\n");
+    this->writeNgrams(out, i);
+  }
+}
 
-      delete ngramToken;
-    }
+void ByteNgrams::decodeNgram(const char *key, size_t length, int n,
+                             utf8_string &ngram) {
+  static const char hexDigits[] = "0123456789abcdef";
+  for (size_t i = 0; i < length; i++) {
+    ngram.append(hexDigits[(unsigned char)key[i] >> 4]);
+    ngram.append(hexDigits[(unsigned char)key[i] & 15]);
   }
 }
 
-void ByteNgrams::getNgrams(ngram_vector<NgramToken *> &ngram_vector, int n) {
-  // Get sorted item list
-  // ngram_vector<string> & keyngram_vector = getKeys( );
-  // ngram_vector<NgramValue> & valuengram_vector = getValues( );
-  auto &item_vector = getItems();
-  size_t count = item_vector.count();
-  for (unsigned i = 0; i < count; i++) {
-    auto item = item_vector[i];
-    if (item && item->value.n == n) {
-      ngram_vector.add(new NgramToken(item->key, item->value));
-      // ngram_vector.add( NgramToken( item->key, item->value ) );
+bool ByteNgrams::encodeNgram(const char *ngram, size_t length, int n,
+                             utf8_string &key) {
+  if (length != (size_t)n * 2) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i += 2) {
+    char hex[3] = {ngram[i], ngram[i + 1], 0};
+    char *hexEnd;
+    key.append((int)strtol(hex, &hexEnd, 16));
+    if (hexEnd != hex + 2) {
+      return false;
     }
   }
+  return true;
 }
@@ -0,0 +1,111 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/byte_set.h>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+void ByteSet::clear() {
+  memset(members, 0, sizeof(members));
+  memset(lowNibbles, 0, sizeof(lowNibbles));
+}
+
+void ByteSet::add(unsigned char c) {
+  members[c] = 1;
+  lowNibbles[c >> 7][c & 0x0f] |= (unsigned char)(1 << ((c >> 4) & 7));
+}
+
+void ByteSet::add(const char *chars) {
+  for (const char *p = chars; *p; p++) {
+    this->add((unsigned char)*p);
+  }
+}
+
+void ByteSet::add(const ByteSet &other) {
+  for (int c = 0; c < 256; c++) {
+    if (other.members[c]) {
+      this->add((unsigned char)c);
+    }
+  }
+}
+
+uint32_t ByteSet::classify(const char *p, size_t length) const {
+#if defined(__AVX2__)
+  if (length >= BLOCK_SIZE) {
+    // pshufb gives 0 for the indexes with the top bit set, so each table
+    // only answers for its half of the bytes
+    const __m256i lowTable = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)lowNibbles[0]));
+    const __m256i highTable = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)lowNibbles[1]));
+    const __m256i bitTable = _mm256_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8,
+        16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m256i bytes = _mm256_loadu_si256((const __m256i *)p);
+    __m256i rows = _mm256_or_si256(
+        _mm256_shuffle_epi8(lowTable, bytes),
+        _mm256_shuffle_epi8(highTable,
+                            _mm256_xor_si256(bytes, _mm256_set1_epi8(-128))));
+    __m256i highNibbles =
+        _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0f));
+    __m256i bits = _mm256_shuffle_epi8(bitTable, highNibbles);
+    return (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_and_si256(rows, bits), bits));
+  }
+#elif defined(__SSSE3__)
+  if (length >= BLOCK_SIZE) {
+    // as with AVX2, 16 bytes at a time
+    const __m128i lowTable = _mm_loadu_si128((const __m128i *)lowNibbles[0]);
+    const __m128i highTable = _mm_loadu_si128((const __m128i *)lowNibbles[1]);
+    const __m128i bitTable = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2,
+                                           4, 8, 16, 32, 64, -128);
+    uint32_t mask = 0;
+    for (int half = 0; half < 2; half++) {
+      __m128i bytes = _mm_loadu_si128((const __m128i *)(p + half * 16));
+      __m128i rows = _mm_or_si128(
+          _mm_shuffle_epi8(lowTable, bytes),
+          _mm_shuffle_epi8(highTable,
+                           _mm_xor_si128(bytes, _mm_set1_epi8(-128))));
+      __m128i highNibbles =
+          _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0f));
+      __m128i bits = _mm_shuffle_epi8(bitTable, highNibbles);
+      mask |= (uint32_t)_mm_movemask_epi8(
+                  _mm_cmpeq_epi8(_mm_and_si128(rows, bits), bits))
+              << (half * 16);
+    }
+    return mask;
+  }
+#endif
+  if (length > BLOCK_SIZE) {
+    length = BLOCK_SIZE;
+  }
+  uint32_t mask = 0;
+  for (size_t i = 0; i < length; i++) {
+    mask |= (uint32_t)members[(unsigned char)p[i]] << i;
+  }
+  return mask;
+}
@@ -24,142 +24,155 @@ WebSite: http://www.cs.dal.ca/~zyu
 *************************************************************************/
 
 #include <ngram/char_ngrams.h>
+#include <ngram/utf8_chars.h>
+
+#include <utf8.h>
+
+#include <cinttypes>
 
 CharNgrams::CharNgrams(int newNgramN, const char *newInFileName,
                        const char *newOutFileName, const char *newDelimiters,
-                       const char *newStopChars)
+                       const char *newStopChars,
+                       const NgramOptions &newOptions)
     : Ngrams(newNgramN, newInFileName, newOutFileName, newDelimiters,
-             newStopChars) {
-  addTokens();
+             newStopChars, newOptions),
+      isSpecialChar(false), pendingLength(0) {
+  if (newInFileName) {
+    addTokens();
+  }
 }
 
-CharNgrams::~CharNgrams() {}
-
-void CharNgrams::addTokens() {
-  // get token string from input file
-  auto &inFileName = getInFileName();
-  FILE *fp = inFileName.length() > 0 ? fopen(inFileName.c_str(), "r") : stdin;
+CharNgrams::CharNgrams(const CharNgrams *parent)
+    : Ngrams(parent), isSpecialChar(false), pendingLength(0) {}
 
-  if (fp == NULL) {
-    printf("CharNgrams:addTokens - failed to open file %s\n",
-           inFileName.c_str());
-  } else {
-    int count = 0;
-    char c[2];
-    c[1] = 0;
-    bool isSpecialChar = false;
-
-    while ((c[0] = (char)toupper(fgetc(fp))) != EOF) {
-      if (isStopChar(c[0])) {
-        c[0] = this->delimiters[0];
-      }
+CharNgrams::~CharNgrams() {}
 
-      if (isDelimiter(c[0])) {
-        c[0] = '_';
-        if (!isSpecialChar) {
-          addToken(c);
-          count++;
-        }
-        isSpecialChar = true;
-
-      } else {
-        addToken(c);
-        isSpecialChar = false;
-        count++;
-      }
+const char *CharNgrams::findShardStart(const char *p, const char *end) const {
+  while (p < end) {
+    unsigned char c = (unsigned char)p[-1];
+    if (!Utf8Chars::isContinuation(*p) &&
+        (c >= 0x80 || (!isStopChar(toupper(c)) && !isDelimiter(toupper(c))))) {
+      break;
     }
-    // special processing need to be done, if less than NGRAM_N tokens in the
-    // whole input text.
-    if (count < this->getN()) {
-      preParse(count);
-    }
-    fclose(fp);
+    p++;
   }
+  return p;
 }
 
-void CharNgrams::preParse(int count) {
-  TokenNode *p, *newHead;
-  p = newHead = head;
-  utf8_string ngram;
-  ngram.reserve(64);
-  while (newHead) {
-    p = newHead;
-    ngram.empty();
-    for (int i = 0; i < count; i++) {
-      ngram += p->token;
-      // printf("%d ngram %s.\n", i, ngram.c_str() );
-      this->addNgram(ngram.c_str(), i + 1);
-      if (p == tail) {
-        break;
+void CharNgrams::tokenize(const char *begin, const char *end) {
+  const char *p = pendingLength > 0 ? this->completePending(begin, end) : begin;
+  while (p < end) {
+    const char *asciiEnd = Utf8Chars::skipAscii(p, end);
+    for (; p < asciiEnd; p++) {
+      this->addChar((unsigned char)*p);
+    }
+    if (p == end) {
+      break;
+    }
+
+    int length = Utf8Chars::sequenceLength(*p);
+    if (end - p < length) {
+      // the sequence may go on in the next block
+      const char *q = p + 1;
+      while (q < end && Utf8Chars::isContinuation(*q)) {
+        q++;
       }
-      p = p->next;
+      if (q == end) {
+        memcpy(pending, p, end - p);
+        pendingLength = (int)(end - p);
+        return;
+      }
+    } else if (utf8::find_invalid(p, p + length) == p + length) {
+      this->addChar(utf8::unchecked::next(p));
+      continue;
     }
-    newHead = newHead->next;
+    this->addChar(Utf8Chars::REPLACEMENT_CHAR);
+    p++;
   }
 }
-void CharNgrams::parse() {
-  TokenNode *p, *newHead;
-  p = newHead = head;
-  utf8_string ngram;
-  ngram.reserve(64);
-  while (newHead) {
-    int n = 0;
-    p = newHead;
-    ngram.empty();
-    while (p) {
-      ngram += p->token;
-      n++;
-      p = p->next;
-    }
-    // printf("%d ngram %s.\n", n, ngram.c_str() );
-    if (n > 0) {
-      this->addNgram(ngram.c_str(), n);
+
+const char *CharNgrams::completePending(const char *begin, const char *end) {
+  const char *p = begin;
+  int length = Utf8Chars::sequenceLength(pending[0]);
+  while (pendingLength < length && p < end && Utf8Chars::isContinuation(*p)) {
+    pending[pendingLength++] = *p++;
+  }
+  if (pendingLength < length && p == end) {
+    return p;
+  }
+  if (pendingLength == length &&
+      utf8::find_invalid(pending, pending + length) == pending + length) {
+    const char *q = pending;
+    this->addChar(utf8::unchecked::next(q));
+  } else {
+    // as when the sequence is not cut, each byte is invalid
+    for (int i = 0; i < pendingLength; i++) {
+      this->addChar(Utf8Chars::REPLACEMENT_CHAR);
     }
-    newHead = newHead->next;
   }
+  pendingLength = 0;
+  return p;
 }
 
-void CharNgrams::output() {
-  int ngramN = this->getN();
+void CharNgrams::finishTokens() {
+  for (int i = 0; i < pendingLength; i++) {
+    this->addChar(Utf8Chars::REPLACEMENT_CHAR);
+  }
+  pendingLength = 0;
+  isSpecialChar = false;
+}
 
-  printf("BEGIN OUTPUT\n");
-  printf("Total %d unique ngram in %d ngrams.\n", this->count(), this->total());
-  fprintf(stderr, "Total %d unique ngram in %d ngrams.\n", this->count(),
-          this->total());
+void CharNgrams::addChar(uint32_t c) {
+  c = Utf8Chars::toUpper(c);
+  if (c < 0x80 && isStopChar(c)) {
+    c = (unsigned char)this->delimiters[0];
+  }
 
-  for (int i = 1; i <= ngramN; i++) {
-    // Get sorted item list
-    ngram_vector<NgramToken *> ngramVector;
-    this->getNgrams(ngramVector, i);
-
-    printf("\n%d-GRAMS ( Total %d unique ngrams in %d grams )\n", i,
-           this->count(i), this->total(i));
-    fprintf(stderr, "\n%d-GRAMS ( Total %d unique ngrams in %d grams )\n", i,
-            this->count(i), this->total(i));
-    printf("------------------------\n");
-
-    size_t count = ngramVector.count();
-    ngramVector.sort(INgrams::compareFunction);
-    for (unsigned j = 0; j < count; j++) {
-      NgramToken *ngramToken = ngramVector[j];
-      printf("%s\t%d\n", ngramToken->ngram.c_str(),
-             ngramToken->value.frequency);
-      delete ngramToken;
+  if (c < 0x80 && isDelimiter(c)) {
+    // a run of delimiters becomes one '_' token
+    if (!isSpecialChar) {
+      addToken("_", 1);
     }
+    isSpecialChar = true;
+
+  } else {
+    char bytes[4];
+    char *bytesEnd = utf8::unchecked::append(c, bytes);
+    addToken(bytes, bytesEnd - bytes);
+    isSpecialChar = false;
   }
 }
 
-void CharNgrams::getNgrams(ngram_vector<NgramToken *> &ngramVector, int n) {
-  // Get sorted item list
-  // ngram_vector<string> & keyVector = getKeys( );
-  // ngram_vector<NgramValue> & valueVector = getValues( );
-  ngram_vector<TstItem<NgramValue> *> &itemVector = getItems();
-  size_t count = itemVector.count();
-  for (unsigned i = 0; i < count; i++) {
-    TstItem<NgramValue> *item = itemVector[i];
-    if (item && item->value.n == n) {
-      ngramVector.add(new NgramToken(item->key, item->value));
-      // ngramVector.add( NgramToken( item->key, item->value ) );
-    }
+void CharNgrams::outputText() {
+  int ngramN = this->getN();
+  OutputWriter out;
+  if (!out.open(getOutFileName().c_str())) {
+    printf("CharNgrams:output - failed to open file %s\n",
+           getOutFileName().c_str());
+    return;
+  }
+
+  out.write("BEGIN OUTPUT\n");
+  out.format("Total %" PRId64 " unique ngram in %" PRId64 " ngrams.\n",
+             this->count(), this->total());
+  fprintf(stderr, "Total %" PRId64 " unique ngram in %" PRId64 " ngrams.\n",
+          this->count(), this->total());
+  if (this->getPrunedCount()) {
+    out.format("Rare ngrams were pruned while counting, frequencies may be "
+               "up to %" PRId64 " too low.\n",
+               this->getPrunedCount());
+  }
+  this->writeApproximation(out);
+
+  for (int i = 1; i <= ngramN; i++) {
+    out.format("\n%d-GRAMS ( Total %" PRId64 " unique ngrams in %" PRId64
+               " grams )\n",
+               i, this->count(i), this->total(i));
+    fprintf(stderr,
+            "\n%d-GRAMS ( Total %" PRId64 " unique ngrams in %" PRId64
+            " grams )\n",
+            i, this->count(i), this->total(i));
+    out.write("------------------------\n");
+    this->writeNgrams(out, i);
   }
 }
@@ -0,0 +1,70 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/count_min_sketch.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+CountMinSketch::CountMinSketch(size_t newWidth, int newDepth) {
+  width = 64;
+  while (width < newWidth) {
+    width <<= 1;
+  }
+  depth = newDepth < 1 ? 1 : newDepth > MAX_DEPTH ? MAX_DEPTH : newDepth;
+  size_t size = width * depth * sizeof(int64_t);
+  counterBlock = (char *)malloc(size + 63);
+  counters = (int64_t *)(((uintptr_t)counterBlock + 63) & ~(uintptr_t)63);
+  memset(counters, 0, size);
+}
+
+CountMinSketch::~CountMinSketch() { free(counterBlock); }
+
+int64_t CountMinSketch::add(uint64_t hash, int64_t frequency) {
+  size_t columns[MAX_DEPTH];
+  getColumns(hash, columns);
+  // conservative update, the counters already above the new estimate are
+  // left alone
+  int64_t estimate = getMinimum(columns) + frequency;
+  for (int i = 0; i < depth; i++) {
+    if (counters[columns[i]] < estimate) {
+      counters[columns[i]] = estimate;
+    }
+  }
+  return estimate;
+}
+
+int64_t CountMinSketch::estimate(uint64_t hash) const {
+  size_t columns[MAX_DEPTH];
+  getColumns(hash, columns);
+  return getMinimum(columns);
+}
+
+int64_t CountMinSketch::getErrorBound(int64_t total) const {
+  return (int64_t)ceil(exp(1.0) / width * total);
+}
+
+double CountMinSketch::getConfidence() const { return 1 - exp(-depth); }
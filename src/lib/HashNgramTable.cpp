@@ -0,0 +1,192 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/hash_ngram_table.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HASH_TABLE_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static inline unsigned firstBit(unsigned mask) {
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (unsigned)index;
+}
+#else
+static inline unsigned firstBit(unsigned mask) {
+  return (unsigned)__builtin_ctz(mask);
+}
+#endif
+
+/**
+ * bit i set if control byte i of the group equals tag
+ */
+static inline unsigned matchGroup(const unsigned char *group,
+                                  unsigned char tag) {
+#ifdef HASH_TABLE_SSE2
+  __m128i controls = _mm_load_si128((const __m128i *)group);
+  return (unsigned)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(controls, _mm_set1_epi8((char)tag)));
+#else
+  unsigned mask = 0;
+  for (unsigned i = 0; i < 16; i++) {
+    mask |= (unsigned)(group[i] == tag) << i;
+  }
+  return mask;
+#endif
+}
+
+HashNgramTable::HashNgramTable()
+    : controlBlock(0), controls(0), slots(0), capacity(0), groupMask(0),
+      arenaNext(0), arenaLeft(0) {
+  rehash(MIN_CAPACITY);
+}
+
+HashNgramTable::~HashNgramTable() {
+  free(controlBlock);
+  free(slots);
+  for (size_t i = 0; i < arenaBlocks.count(); i++) {
+    free(arenaBlocks[i]);
+  }
+}
+
+NgramTable::NgramValue *HashNgramTable::add(Cursor cursor, const char *key,
+                                            size_t length, int n,
+                                            bool &added) {
+  uint64_t hash = mix(cursor);
+  unsigned char tag = (unsigned char)(hash & 0x7F);
+  size_t group = (size_t)(hash >> 7) & groupMask;
+
+  // triangular probing over groups, visits every group once
+  for (size_t step = 1;; step++) {
+    const unsigned char *groupControls = controls + group * GROUP_SIZE;
+    unsigned match = matchGroup(groupControls, tag);
+    while (match) {
+      Item &item = items[slots[group * GROUP_SIZE + firstBit(match)]];
+      if (item.hash == hash && item.length == length &&
+          memcmp(item.getKey(), key, length) == 0) {
+        added = false;
+        return &item.value;
+      }
+      match &= match - 1;
+    }
+    if (matchGroup(groupControls, EMPTY)) {
+      break; // key not found
+    }
+    group = (group + step) & groupMask;
+  }
+
+  if (items.count() == MAX_ITEMS) {
+    fprintf(stderr, "HashNgramTable:add - more than %zu ngrams\n", MAX_ITEMS);
+    abort();
+  }
+  Item item;
+  item.hash = hash;
+  if (length <= INLINE_KEY_SIZE) {
+    memcpy(item.key.bytes, key, length);
+  } else {
+    item.key.pointer = storeKey(key, length);
+  }
+  item.length = (uint32_t)length;
+  item.value = NgramValue(n, 0);
+  items.add(item);
+
+  // keep load factor under 7/8
+  if (items.count() > capacity - (capacity >> 3)) {
+    rehash(capacity << 1);
+  } else {
+    insertSlot(hash, (uint32_t)(items.count() - 1));
+  }
+  added = true;
+  return &items[items.count() - 1].value;
+}
+
+void HashNgramTable::reserve(size_t keyCount) {
+  if (keyCount > items.capacity()) {
+    items.reserve(keyCount);
+  }
+  size_t newCapacity = capacity;
+  while (keyCount > newCapacity - (newCapacity >> 3)) {
+    newCapacity <<= 1;
+  }
+  if (newCapacity > capacity) {
+    rehash(newCapacity);
+  }
+}
+
+void HashNgramTable::insertSlot(uint64_t hash, uint32_t index) {
+  size_t group = (size_t)(hash >> 7) & groupMask;
+  for (size_t step = 1;; step++) {
+    unsigned char *groupControls = controls + group * GROUP_SIZE;
+    unsigned empty = matchGroup(groupControls, EMPTY);
+    if (empty) {
+      size_t slot = group * GROUP_SIZE + firstBit(empty);
+      controls[slot] = (unsigned char)(hash & 0x7F);
+      slots[slot] = index;
+      return;
+    }
+    group = (group + step) & groupMask;
+  }
+}
+
+void HashNgramTable::rehash(size_t newCapacity) {
+  free(controlBlock);
+  free(slots);
+  capacity = newCapacity;
+  groupMask = capacity / GROUP_SIZE - 1;
+  // control groups are loaded with aligned SSE2 loads
+  controlBlock = (unsigned char *)malloc(capacity + GROUP_SIZE);
+  controls = controlBlock + GROUP_SIZE -
+             ((uintptr_t)controlBlock & (GROUP_SIZE - 1));
+  memset(controls, EMPTY, capacity);
+  slots = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+
+  size_t count = items.count();
+  for (size_t i = 0; i < count; i++) {
+    insertSlot(items[i].hash, (uint32_t)i);
+  }
+}
+
+const char *HashNgramTable::storeKey(const char *key, size_t length) {
+  if (length + 1 > arenaLeft) {
+    size_t blockSize =
+        length + 1 > ARENA_BLOCK_SIZE ? length + 1 : ARENA_BLOCK_SIZE;
+    arenaNext = (char *)malloc(blockSize);
+    arenaLeft = blockSize;
+    arenaBlocks.add(arenaNext);
+  }
+  char *stored = arenaNext;
+  memcpy(stored, key, length);
+  stored[length] = 0;
+  arenaNext += length + 1;
+  arenaLeft -= length + 1;
+  return stored;
+}
@@ -0,0 +1,114 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/hyper_log_log.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HYPER_LOG_LOG_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static inline int leadingZeros(uint64_t bits) {
+  unsigned long index;
+  _BitScanReverse64(&index, bits);
+  return 63 - (int)index;
+}
+#else
+static inline int leadingZeros(uint64_t bits) { return __builtin_clzll(bits); }
+#endif
+
+HyperLogLog::HyperLogLog(int newPrecision) {
+  precision = newPrecision < MIN_PRECISION   ? MIN_PRECISION
+              : newPrecision > MAX_PRECISION ? MAX_PRECISION
+                                             : newPrecision;
+  registerCount = (size_t)1 << precision;
+  registers = new uint8_t[registerCount];
+  memset(registers, 0, registerCount);
+}
+
+HyperLogLog::~HyperLogLog() { delete[] registers; }
+
+void HyperLogLog::add(uint64_t hash) {
+  size_t index = (size_t)(hash >> (64 - precision));
+  // the bit below the other bits caps the rank when they are all 0
+  uint64_t bits = hash << precision | (uint64_t)1 << (precision - 1);
+  uint8_t rank = (uint8_t)(leadingZeros(bits) + 1);
+  if (registers[index] < rank) {
+    registers[index] = rank;
+  }
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+  if (other.precision != precision) {
+    printf("HyperLogLog:merge - failed to merge precision %d into %d\n",
+           other.precision, precision);
+    return;
+  }
+#ifdef HYPER_LOG_LOG_SSE2
+  // there are at least 16 registers, a multiple of 16
+  for (size_t i = 0; i < registerCount; i += 16) {
+    __m128i mine = _mm_loadu_si128((const __m128i *)(registers + i));
+    __m128i theirs = _mm_loadu_si128((const __m128i *)(other.registers + i));
+    _mm_storeu_si128((__m128i *)(registers + i), _mm_max_epu8(mine, theirs));
+  }
+#else
+  for (size_t i = 0; i < registerCount; i++) {
+    if (registers[i] < other.registers[i]) {
+      registers[i] = other.registers[i];
+    }
+  }
+#endif
+}
+
+int64_t HyperLogLog::estimate() const {
+  double m = (double)registerCount;
+  double alpha = registerCount == 16   ? 0.673
+                 : registerCount == 32 ? 0.697
+                 : registerCount == 64 ? 0.709
+                                       : 0.7213 / (1 + 1.079 / m);
+  double sum = 0;
+  size_t empty = 0;
+  for (size_t i = 0; i < registerCount; i++) {
+    sum += ldexp(1.0, -registers[i]);
+    if (registers[i] == 0) {
+      ++empty;
+    }
+  }
+  double estimate = alpha * m * m / sum;
+  if (estimate <= 2.5 * m && empty > 0) {
+    estimate = m * log(m / empty);
+  }
+  return (int64_t)(estimate + 0.5);
+}
+
+double HyperLogLog::getStandardError() const {
+  return 1.04 / sqrt((double)registerCount);
+}
@@ -0,0 +1,94 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/input_reader.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+InputReader::InputReader()
+    : fp(NULL), map(NULL), mapLength(0), mapRead(false), buffer(NULL) {}
+
+bool InputReader::open(const char *fileName) {
+  close();
+  fp = *fileName ? fopen(fileName, "rb") : stdin;
+  if (fp == NULL) {
+    return false;
+  }
+#ifndef _WIN32
+  struct stat st;
+  if (fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                   fileno(fp), 0);
+    if (p != MAP_FAILED) {
+      map = (char *)p;
+      mapLength = (size_t)st.st_size;
+      mapRead = false;
+      madvise(p, mapLength, MADV_SEQUENTIAL);
+    }
+  }
+#endif
+  return true;
+}
+
+bool InputReader::read(const char *&begin, const char *&end) {
+  if (map) {
+    if (mapRead) {
+      return false;
+    }
+    mapRead = true;
+    begin = map;
+    end = map + mapLength;
+    return true;
+  }
+  if (fp == NULL) {
+    return false;
+  }
+  if (buffer == NULL) {
+    buffer = (char *)malloc(BLOCK_SIZE);
+  }
+  size_t bytesRead = fread(buffer, 1, BLOCK_SIZE, fp);
+  begin = buffer;
+  end = buffer + bytesRead;
+  return bytesRead > 0;
+}
+
+void InputReader::close() {
+#ifndef _WIN32
+  if (map) {
+    munmap(map, mapLength);
+  }
+#endif
+  map = NULL;
+  mapLength = 0;
+  if (fp && fp != stdin) {
+    fclose(fp);
+  }
+  fp = NULL;
+  free(buffer);
+  buffer = NULL;
+}
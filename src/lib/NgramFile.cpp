@@ -0,0 +1,468 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/config.h>
+#include <ngram/ngram_file.h>
+#include <ngram/ngrams_base.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const NgramFileHeader emptyHeader = {};
+
+int NgramFileReader::compareKeys(const char *key1, size_t length1,
+                                 const char *key2, size_t length2) {
+  int ret = memcmp(key1, key2, length1 < length2 ? length1 : length2);
+  if (ret != 0) {
+    return ret;
+  }
+  return length1 < length2 ? -1 : length1 > length2 ? 1 : 0;
+}
+
+NgramFileWriter::NgramFileWriter()
+    : offset(0), header(emptyHeader), orders(NULL), order(0), isOpen(false) {}
+
+bool NgramFileWriter::open(const char *fileName, int type, int maxN) {
+  close();
+  if (!out.open(fileName)) {
+    return false;
+  }
+  isOpen = true;
+  offset = 0;
+  header = emptyHeader;
+  memcpy(header.magic, NGRAM_FILE_MAGIC, sizeof(header.magic));
+  header.byteOrder = NGRAM_FILE_BYTE_ORDER;
+  header.version = NGRAM_FILE_VERSION;
+  header.type = (uint32_t)type;
+  header.maxN = (uint32_t)maxN;
+  orders = new NgramFileOrder[maxN];
+  memset(orders, 0, maxN * sizeof(NgramFileOrder));
+  order = 0;
+  offsets.clear();
+  offsets.add(0);
+  return true;
+}
+
+void NgramFileWriter::addWord(const char *word, size_t length) {
+  assert(order == 0);
+  write(word, length);
+  offsets.add(offset);
+  ++header.wordCount;
+}
+
+void NgramFileWriter::endVocabulary() {
+  align();
+  header.wordIndexOffset = offset;
+  for (size_t i = 0; i < offsets.count(); i++) {
+    write(&offsets[i], sizeof(uint64_t));
+  }
+}
+
+void NgramFileWriter::beginOrder(int n) {
+  assert(n == order + 1 && n <= (int)header.maxN);
+  if (order == 0) {
+    endVocabulary();
+  }
+  order = n;
+  align();
+  orders[n - 1].keyOffset = offset;
+  offsets.resize(0);
+  offsets.add(offset);
+  frequencies.resize(0);
+}
+
+void NgramFileWriter::addNgram(const char *key, size_t length,
+                               uint64_t frequency) {
+  write(key, length);
+  offsets.add(offset);
+  frequencies.add(frequency);
+}
+
+void NgramFileWriter::endOrder(uint64_t total, uint64_t unique) {
+  NgramFileOrder &fileOrder = orders[order - 1];
+  fileOrder.total = total;
+  fileOrder.unique = unique;
+  size_t keyCount = frequencies.count();
+  fileOrder.keyCount = keyCount;
+
+  // keys of one length need no offsets
+  uint64_t keyWidth = keyCount > 0 ? offsets[1] - offsets[0] : 0;
+  for (size_t i = 1; i <= keyCount && keyWidth > 0; i++) {
+    if (offsets[i] - offsets[i - 1] != keyWidth) {
+      keyWidth = 0;
+    }
+  }
+  fileOrder.keyWidth = keyWidth;
+  align();
+  if (keyWidth == 0) {
+    fileOrder.keyIndexOffset = offset;
+    for (size_t i = 0; i <= keyCount; i++) {
+      write(&offsets[i], sizeof(uint64_t));
+    }
+  }
+
+  uint64_t maxFrequency = 1;
+  for (size_t i = 0; i < keyCount; i++) {
+    if (frequencies[i] > maxFrequency) {
+      maxFrequency = frequencies[i];
+    }
+  }
+  unsigned bits = 0;
+  while (bits < 64 && maxFrequency >> bits) {
+    bits++;
+  }
+  fileOrder.countBits = bits;
+  fileOrder.countOffset = offset;
+
+  uint64_t word = 0;
+  unsigned wordBits = 0; // bits used in word
+  for (size_t i = 0; i < keyCount; i++) {
+    uint64_t frequency = frequencies[i];
+    word |= frequency << wordBits;
+    if (wordBits + bits >= 64) {
+      write(&word, sizeof(word));
+      // the high bits of frequency that did not fit
+      word = wordBits > 0 ? frequency >> (64 - wordBits) : 0;
+      wordBits = wordBits + bits - 64;
+    } else {
+      wordBits += bits;
+    }
+  }
+  if (wordBits > 0) {
+    write(&word, sizeof(word));
+  }
+}
+
+bool NgramFileWriter::close() {
+  if (!isOpen) {
+    return true;
+  }
+  if (order == 0) {
+    endVocabulary();
+  }
+  // orders not begun are left empty
+  for (int n = order + 1; n <= (int)header.maxN; n++) {
+    beginOrder(n);
+    endOrder(0, 0);
+  }
+  align();
+  header.orderOffset = offset;
+  write(orders, header.maxN * sizeof(NgramFileOrder));
+  write(&header, sizeof(header));
+  out.close();
+  delete[] orders;
+  orders = NULL;
+  offsets.clear();
+  frequencies.clear();
+  isOpen = false;
+  return !out.hasFailed();
+}
+
+void NgramFileWriter::align() {
+  static const char zeros[8] = {0};
+  if (offset % 8) {
+    write(zeros, 8 - offset % 8);
+  }
+}
+
+void NgramFileWriter::encodeWordKey(const uint32_t *ids, int n, char *key) {
+  for (int i = 0; i < n; i++) {
+    key[i * 4] = (char)(ids[i] >> 24);
+    key[i * 4 + 1] = (char)(ids[i] >> 16);
+    key[i * 4 + 2] = (char)(ids[i] >> 8);
+    key[i * 4 + 3] = (char)ids[i];
+  }
+}
+
+NgramFileReader::NgramFileReader()
+    : data(NULL), length(0), mapped(false), header(&emptyHeader),
+      orders(NULL), wordIndex(NULL) {}
+
+bool NgramFileReader::open(const char *fileName) {
+  close();
+  FILE *fp = fopen(fileName, "rb");
+  if (fp == NULL) {
+    return false;
+  }
+#ifndef _WIN32
+  struct stat st;
+  if (fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                   fileno(fp), 0);
+    if (p != MAP_FAILED) {
+      data = (const char *)p;
+      length = (size_t)st.st_size;
+      mapped = true;
+      madvise(p, length, MADV_RANDOM);
+    }
+  }
+#endif
+  if (data == NULL) {
+    // read the whole file where it can not be mapped
+    size_t size = 0;
+    char *buffer = NULL;
+    size_t bytesRead;
+    do {
+      buffer = (char *)realloc(buffer, size + (1 << 20));
+      bytesRead = fread(buffer + size, 1, 1 << 20, fp);
+      size += bytesRead;
+    } while (bytesRead > 0);
+    data = buffer;
+    length = size;
+  }
+  fclose(fp);
+
+  if (length < sizeof(NgramFileHeader)) {
+    close();
+    return false;
+  }
+  header =
+      (const NgramFileHeader *)(data + length - sizeof(NgramFileHeader));
+  if (!validate()) {
+    close();
+    return false;
+  }
+  orders = (const NgramFileOrder *)(data + header->orderOffset);
+  wordIndex = (const uint64_t *)(data + header->wordIndexOffset);
+  return true;
+}
+
+bool NgramFileReader::validate() const {
+  if (memcmp(header->magic, NGRAM_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->byteOrder != NGRAM_FILE_BYTE_ORDER ||
+      header->version != NGRAM_FILE_VERSION) {
+    return false;
+  }
+  uint64_t end = length - sizeof(NgramFileHeader);
+  if (header->orderOffset % 8 || header->orderOffset > end ||
+      (end - header->orderOffset) / sizeof(NgramFileOrder) < header->maxN) {
+    return false;
+  }
+  if (!isIndex(header->wordIndexOffset, header->wordCount, end)) {
+    return false;
+  }
+  const NgramFileOrder *fileOrders =
+      (const NgramFileOrder *)(data + header->orderOffset);
+  for (uint32_t i = 0; i < header->maxN; i++) {
+    const NgramFileOrder &fileOrder = fileOrders[i];
+    uint64_t keyCount = fileOrder.keyCount;
+    if (keyCount > end || fileOrder.countBits < 1 ||
+        fileOrder.countBits > 64 || fileOrder.countOffset % 8 ||
+        fileOrder.countOffset > end ||
+        (end - fileOrder.countOffset) / 8 <
+            (keyCount * fileOrder.countBits + 63) / 64) {
+      return false;
+    }
+    if (fileOrder.keyWidth
+            ? fileOrder.keyOffset > end || fileOrder.keyWidth > end ||
+                  (keyCount > 0 &&
+                   (end - fileOrder.keyOffset) / keyCount < fileOrder.keyWidth)
+            : !isIndex(fileOrder.keyIndexOffset, keyCount, end)) {
+      return false;
+    }
+    // word ngram keys are N word ids
+    if (header->type == Config::WORD_NGRAM && keyCount > 0 &&
+        fileOrder.keyWidth != (uint64_t)(i + 1) * 4) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool NgramFileReader::isIndex(uint64_t offset, uint64_t count,
+                              uint64_t end) const {
+  if (offset % 8 || offset > end || (end - offset) / 8 <= count) {
+    return false;
+  }
+  // the indexed bytes lie in order before the index
+  const uint64_t *index = (const uint64_t *)(data + offset);
+  if (index[count] > offset) {
+    return false;
+  }
+  for (uint64_t i = 0; i < count; i++) {
+    if (index[i] > index[i + 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void NgramFileReader::close() {
+#ifndef _WIN32
+  if (mapped) {
+    munmap((void *)data, length);
+  }
+#endif
+  if (!mapped) {
+    free((void *)data);
+  }
+  data = NULL;
+  length = 0;
+  mapped = false;
+  header = &emptyHeader;
+  orders = NULL;
+  wordIndex = NULL;
+}
+
+const char *NgramFileReader::getKey(int n, size_t index,
+                                    size_t &length) const {
+  const NgramFileOrder &fileOrder = orders[n - 1];
+  if (fileOrder.keyWidth) {
+    length = (size_t)fileOrder.keyWidth;
+    return data + fileOrder.keyOffset + index * length;
+  }
+  const uint64_t *keyIndex =
+      (const uint64_t *)(data + fileOrder.keyIndexOffset);
+  length = (size_t)(keyIndex[index + 1] - keyIndex[index]);
+  return data + keyIndex[index];
+}
+
+uint64_t NgramFileReader::getFrequency(int n, size_t index) const {
+  const NgramFileOrder &fileOrder = orders[n - 1];
+  const uint64_t *words = (const uint64_t *)(data + fileOrder.countOffset);
+  unsigned bits = fileOrder.countBits;
+  uint64_t bit = (uint64_t)index * bits;
+  size_t word = (size_t)(bit / 64);
+  unsigned shift = (unsigned)(bit % 64);
+  uint64_t value = words[word] >> shift;
+  if (shift + bits > 64) {
+    value |= words[word + 1] << (64 - shift);
+  }
+  return bits == 64 ? value : value & (((uint64_t)1 << bits) - 1);
+}
+
+bool NgramFileReader::find(int n, const char *key, size_t length,
+                           size_t &index) const {
+  if (!isOrder(n)) {
+    return false;
+  }
+  size_t low = 0;
+  size_t high = (size_t)orders[n - 1].keyCount;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    size_t middleLength;
+    const char *middleKey = getKey(n, middle, middleLength);
+    int ret = compareKeys(middleKey, middleLength, key, length);
+    if (ret == 0) {
+      index = middle;
+      return true;
+    }
+    if (ret < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return false;
+}
+
+uint64_t NgramFileReader::getFrequency(int n, const char *key,
+                                       size_t length) const {
+  size_t index;
+  return find(n, key, length, index) ? getFrequency(n, index) : 0;
+}
+
+uint64_t NgramFileReader::getFrequency(const char *const *words,
+                                       int n) const {
+  if (!isOrder(n)) {
+    return 0;
+  }
+  uint32_t ids[INgrams::MAX_N];
+  char key[INgrams::MAX_N * 4];
+  for (int i = 0; i < n; i++) {
+    if (!findWord(words[i], strlen(words[i]), ids[i])) {
+      return 0;
+    }
+  }
+  NgramFileWriter::encodeWordKey(ids, n, key);
+  return getFrequency(n, key, n * 4);
+}
+
+const char *NgramFileReader::getWord(uint32_t id, size_t &length) const {
+  if (id >= header->wordCount) {
+    length = 0;
+    return NULL;
+  }
+  length = (size_t)(wordIndex[id + 1] - wordIndex[id]);
+  return data + wordIndex[id];
+}
+
+bool NgramFileReader::findWord(const char *word, size_t length,
+                               uint32_t &id) const {
+  size_t low = 0;
+  size_t high = (size_t)header->wordCount;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    size_t middleLength;
+    const char *middleWord = getWord((uint32_t)middle, middleLength);
+    int ret = compareKeys(middleWord, middleLength, word, length);
+    if (ret == 0) {
+      id = (uint32_t)middle;
+      return true;
+    }
+    if (ret < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return false;
+}
+
+bool NgramFileReader::decodeNgram(int n, size_t index,
+                                  utf8_string &ngram) const {
+  size_t keyLength;
+  const char *key = getKey(n, index, keyLength);
+  if (header->type == Config::WORD_NGRAM) {
+    for (int i = 0; i < n; i++) {
+      const unsigned char *p = (const unsigned char *)key + i * 4;
+      uint32_t id = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+                    (uint32_t)p[2] << 8 | p[3];
+      size_t wordLength;
+      const char *word = getWord(id, wordLength);
+      if (word == NULL) {
+        return false;
+      }
+      ngram.append(word, wordLength);
+      if (i < n - 1) {
+        ngram.append('_');
+      }
+    }
+  } else if (header->type == Config::BYTE_NGRAM) {
+    static const char hexDigits[] = "0123456789abcdef";
+    for (size_t i = 0; i < keyLength; i++) {
+      ngram.append(hexDigits[(unsigned char)key[i] >> 4]);
+      ngram.append(hexDigits[(unsigned char)key[i] & 15]);
+    }
+  } else {
+    ngram.append(key, keyLength);
+  }
+  return true;
+}
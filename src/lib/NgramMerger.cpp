@@ -0,0 +1,294 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/byte_ngrams.h>
+#include <ngram/char_ngrams.h>
+#include <ngram/ngram_merger.h>
+#include <ngram/word_ngrams.h>
+
+#include <algorithm>
+
+bool NgramMerger::merge(const char *const *inFileNames, int fileCount,
+                        const char *outFileName) {
+  // only binary inputs merge in one pass, and only into a binary file, since
+  // the text output is in the order of frequency
+  bool sorted = options.format == Config::BINARY_FORMAT &&
+                options.top.count() == 0;
+  int type = -1;
+  int maxN = 0;
+  bool ret = true;
+  NgramFileReader *readers = new NgramFileReader[fileCount];
+  for (int i = 0; i < fileCount && ret; i++) {
+    int fileType;
+    int fileN;
+    if (readers[i].open(inFileNames[i])) {
+      fileType = readers[i].getType();
+      fileN = readers[i].getN();
+    } else if (probe(inFileNames[i], fileType, fileN)) {
+      sorted = false;
+    } else {
+      printf("NgramMerger:merge - failed to open file %s\n", inFileNames[i]);
+      ret = false;
+      break;
+    }
+    if (fileType < 0) {
+      continue; // no ngrams
+    }
+    if (type >= 0 && fileType != type) {
+      printf("NgramMerger:merge - file %s holds another kind of ngrams\n",
+             inFileNames[i]);
+      ret = false;
+    }
+    type = fileType;
+    maxN = std::max(maxN, fileN);
+  }
+  if (ret && type < 0) {
+    printf("NgramMerger:merge - no ngrams to merge\n");
+    ret = false;
+  }
+
+  if (ret && sorted) {
+    ret = mergeSorted(readers, fileCount, outFileName);
+  } else if (ret) {
+    for (int i = 0; i < fileCount; i++) {
+      readers[i].close();
+    }
+    Ngrams *ngrams = createNgrams(type, maxN, outFileName, options);
+    for (int i = 0; i < fileCount && ret; i++) {
+      ret = ngrams->load(inFileNames[i]);
+    }
+    if (ret) {
+      ngrams->output();
+    }
+    delete ngrams;
+  }
+  delete[] readers;
+  return ret;
+}
+
+Ngrams *NgramMerger::createNgrams(int type, int n, const char *outFileName,
+                                  const NgramOptions &options) {
+  if (type == Config::CHAR_NGRAM) {
+    return new CharNgrams(n, NULL, outFileName, Config::getDefaultDelimiters(),
+                          Config::getDefaultStopChars(), options);
+  }
+  if (type == Config::BYTE_NGRAM) {
+    return new ByteNgrams(n, NULL, outFileName, "", "", options);
+  }
+  return new WordNgrams(n, NULL, outFileName, Config::getDefaultDelimiters(),
+                        Config::getDefaultStopChars(), options);
+}
+
+bool NgramMerger::probe(const char *fileName, int &type, int &maxN) {
+  NgramTextReader reader;
+  if (!*fileName || !reader.open(fileName)) {
+    return false;
+  }
+  type = -1;
+  maxN = 0;
+  int entry;
+  while ((entry = reader.next()) != NgramTextReader::END) {
+    if (entry == NgramTextReader::ORDER) {
+      type = reader.getType();
+      maxN = std::max(maxN, reader.getN());
+    }
+  }
+  return true;
+}
+
+/**
+ * a file merged by NgramMerger::mergeSorted, positioned at one of its
+ * ngrams or words
+ */
+struct MergeSource {
+  const NgramFileReader *reader;
+  uint32_t *wordIds; // id in the merged vocabulary of each word of the file
+  size_t index;      // index of the current ngram or word
+  const char *key;   // key of the current ngram or the current word
+  size_t length;
+  char *keyBuffer; // key with the word ids replaced
+  bool corrupt;    // whether a key holds a word id out of the vocabulary
+};
+
+/**
+ * orders merge sources by their current key, for a min heap
+ */
+static bool sourceGreater(const MergeSource *a, const MergeSource *b) {
+  return NgramFileReader::compareKeys(a->key, a->length, b->key, b->length) >
+         0;
+}
+
+/**
+ * move a source to its word of given index
+ * @return	false past the last word
+ */
+static bool setWord(MergeSource &source, size_t index) {
+  source.index = index;
+  if (index == source.reader->getWordCount()) {
+    return false;
+  }
+  source.key = source.reader->getWord((uint32_t)index, source.length);
+  return true;
+}
+
+/**
+ * move a source to its ngram of given N and index, with the word ids of the
+ * key replaced by those of the merged vocabulary
+ * @return	false past the last ngram of N, or on a corrupt key
+ */
+static bool setNgram(MergeSource &source, int n, size_t index) {
+  source.index = index;
+  if (index == source.reader->getKeyCount(n)) {
+    return false;
+  }
+  source.key = source.reader->getKey(n, index, source.length);
+  if (source.reader->getType() == Config::WORD_NGRAM) {
+    for (int i = 0; i < n; i++) {
+      const unsigned char *p = (const unsigned char *)source.key + i * 4;
+      uint32_t id = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+                    (uint32_t)p[2] << 8 | p[3];
+      if (id >= source.reader->getWordCount()) {
+        source.corrupt = true;
+        return false;
+      }
+      NgramFileWriter::encodeWordKey(&source.wordIds[id], 1,
+                                     source.keyBuffer + i * 4);
+    }
+    source.key = source.keyBuffer;
+  }
+  return true;
+}
+
+bool NgramMerger::mergeSorted(NgramFileReader *readers, int fileCount,
+                              const char *outFileName) {
+  int maxN = 0;
+  int64_t prunedCount = 0;
+  for (int i = 0; i < fileCount; i++) {
+    maxN = std::max(maxN, readers[i].getN());
+    prunedCount += readers[i].getPrunedCount();
+  }
+  NgramFileWriter writer;
+  if (!writer.open(outFileName, readers[0].getType(), maxN)) {
+    printf("NgramMerger:merge - failed to open file %s\n", outFileName);
+    return false;
+  }
+  writer.setPrunedCount(prunedCount);
+
+  MergeSource *sources = new MergeSource[fileCount];
+  MergeSource **heap = new MergeSource *[fileCount];
+  for (int i = 0; i < fileCount; i++) {
+    sources[i].reader = &readers[i];
+    sources[i].wordIds = new uint32_t[readers[i].getWordCount()];
+    sources[i].keyBuffer = new char[maxN * 4];
+    sources[i].corrupt = false;
+  }
+
+  // the sorted vocabularies are merged, ids map to the merged one in order
+  size_t heapSize = 0;
+  for (int i = 0; i < fileCount; i++) {
+    if (setWord(sources[i], 0)) {
+      heap[heapSize++] = &sources[i];
+    }
+  }
+  std::make_heap(heap, heap + heapSize, sourceGreater);
+  uint32_t wordCount = 0;
+  const char *word = NULL;
+  size_t wordLength = 0;
+  while (heapSize > 0) {
+    MergeSource &source = *heap[0];
+    if (word == NULL || NgramFileReader::compareKeys(
+                            source.key, source.length, word, wordLength) != 0) {
+      word = source.key;
+      wordLength = source.length;
+      writer.addWord(word, wordLength);
+      ++wordCount;
+    }
+    source.wordIds[source.index] = wordCount - 1;
+    std::pop_heap(heap, heap + heapSize, sourceGreater);
+    if (setWord(source, source.index + 1)) {
+      std::push_heap(heap, heap + heapSize, sourceGreater);
+    } else {
+      --heapSize;
+    }
+  }
+
+  utf8_string key;
+  key.reserve(256);
+  for (int n = 1; n <= maxN; n++) {
+    uint64_t total = 0;
+    uint64_t unique = 0;
+    heapSize = 0;
+    for (int i = 0; i < fileCount; i++) {
+      total += readers[i].total(n);
+      if (setNgram(sources[i], n, 0)) {
+        heap[heapSize++] = &sources[i];
+      }
+    }
+    std::make_heap(heap, heap + heapSize, sourceGreater);
+
+    writer.beginOrder(n);
+    while (heapSize > 0) {
+      key.empty();
+      key.append(heap[0]->key, heap[0]->length);
+      uint64_t frequency = 0;
+      // add up the frequencies of the key in all files
+      while (heapSize > 0 &&
+             NgramFileReader::compareKeys(heap[0]->key, heap[0]->length,
+                                          key.c_str(), key.length()) == 0) {
+        MergeSource &source = *heap[0];
+        frequency += source.reader->getFrequency(n, source.index);
+        std::pop_heap(heap, heap + heapSize, sourceGreater);
+        if (setNgram(source, n, source.index + 1)) {
+          std::push_heap(heap, heap + heapSize, sourceGreater);
+        } else {
+          --heapSize;
+        }
+      }
+      ++unique;
+      if ((int64_t)frequency >= options.minCount) {
+        writer.addNgram(key.c_str(), key.length(), frequency);
+      }
+    }
+    writer.endOrder(total, unique);
+  }
+
+  bool ret = true;
+  for (int i = 0; i < fileCount; i++) {
+    if (sources[i].corrupt) {
+      printf("NgramMerger:merge - input %d holds an unknown word id\n",
+             i + 1);
+      ret = false;
+    }
+    delete[] sources[i].wordIds;
+    delete[] sources[i].keyBuffer;
+  }
+  delete[] sources;
+  delete[] heap;
+  if (!writer.close()) {
+    printf("NgramMerger:merge - failed to write file %s\n", outFileName);
+    return false;
+  }
+  return ret;
+}
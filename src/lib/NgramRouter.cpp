@@ -0,0 +1,137 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/ngram_router.h>
+
+#include <thread>
+
+NgramRouter::NgramRouter(int producerCount, PartitionedNgramTable *table,
+                         int ngramN)
+    : producerCount(producerCount),
+      partitionCount(table->getPartitionCount()), ngramN(ngramN), table(table),
+      finishedProducers(0) {
+  int queueCount = producerCount * partitionCount;
+  queues = new spsc_queue<Batch *> *[queueCount];
+  for (int i = 0; i < queueCount; i++) {
+    queues[i] = new spsc_queue<Batch *>(QUEUE_SIZE);
+  }
+  batches = new Batch *[queueCount];
+  memset(batches, 0, queueCount * sizeof(Batch *));
+  uniques = new int64_t[partitionCount * ngramN];
+  memset(uniques, 0, partitionCount * ngramN * sizeof(int64_t));
+}
+
+NgramRouter::~NgramRouter() {
+  int queueCount = producerCount * partitionCount;
+  for (int i = 0; i < queueCount; i++) {
+    Batch *batch;
+    while (queues[i]->pop(batch)) {
+      free(batch);
+    }
+    free(batches[i]);
+    delete queues[i];
+  }
+  delete[] queues;
+  delete[] batches;
+  delete[] uniques;
+}
+
+void NgramRouter::add(int producer, NgramTable::Cursor cursor,
+                      const char *ngram, size_t length, int n) {
+  int partition = table->getPartition(cursor);
+  Batch *&batch = batches[producer * partitionCount + partition];
+  size_t recordLength = sizeof(Record) + length;
+  if (batch && batch->length + recordLength > batch->capacity) {
+    send(producer, partition);
+  }
+  if (batch == NULL) {
+    size_t capacity = recordLength > BATCH_SIZE ? recordLength : BATCH_SIZE;
+    batch = (Batch *)malloc(sizeof(Batch) + capacity);
+    batch->length = 0;
+    batch->capacity = capacity;
+  }
+
+  char *record = batch->getRecords() + batch->length;
+  Record header = {cursor, (uint32_t)length, (uint32_t)n};
+  memcpy(record, &header, sizeof(header));
+  memcpy(record + sizeof(header), ngram, length);
+  batch->length += recordLength;
+}
+
+void NgramRouter::send(int producer, int partition) {
+  int i = producer * partitionCount + partition;
+  while (!queues[i]->push(batches[i])) {
+    std::this_thread::yield();
+  }
+  batches[i] = NULL;
+}
+
+void NgramRouter::finish(int producer) {
+  for (int partition = 0; partition < partitionCount; partition++) {
+    if (batches[producer * partitionCount + partition]) {
+      send(producer, partition);
+    }
+  }
+  finishedProducers.fetch_add(1, std::memory_order_release);
+}
+
+void NgramRouter::aggregate(int partition) {
+  int64_t *partitionUniques = uniques + partition * ngramN;
+  while (true) {
+    // all batches are queued once the producers are seen finished
+    bool finished = finishedProducers.load(std::memory_order_acquire) ==
+                    producerCount;
+    bool received = false;
+    for (int producer = 0; producer < producerCount; producer++) {
+      Batch *batch;
+      while (queues[producer * partitionCount + partition]->pop(batch)) {
+        const char *record = batch->getRecords();
+        const char *end = record + batch->length;
+        while (record < end) {
+          Record header;
+          memcpy(&header, record, sizeof(header));
+          record += sizeof(header);
+          bool added;
+          ++table
+                ->add(partition, header.cursor, record, header.length,
+                      header.n, added)
+                ->frequency;
+          if (added) {
+            ++partitionUniques[header.n - 1];
+          }
+          record += header.length;
+        }
+        free(batch);
+        received = true;
+      }
+    }
+    if (!received) {
+      if (finished) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+}
@@ -0,0 +1,368 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/ngram_run.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+NgramRun::NgramRun()
+    : fp(NULL), buffer(NULL), bufferLength(0), bufferPos(0), failed(false),
+      reading(false), key(NULL), keyLength(0), keySize(0), n(0),
+      frequency(0), size(0) {}
+
+NgramRun::~NgramRun() {
+  if (fp) {
+    fclose(fp);
+  }
+  free(buffer);
+  free(key);
+}
+
+bool NgramRun::create() {
+#ifdef _WIN32
+  fp = tmpfile();
+#else
+  // the file is unlinked at once, it goes away when closed
+  const char *dir = getenv("TMPDIR");
+  size_t length = strlen(dir && *dir ? dir : "/tmp");
+  char *fileName = (char *)malloc(length + 32);
+  sprintf(fileName, "%s/ngram-run-XXXXXX", dir && *dir ? dir : "/tmp");
+  int fd = mkstemp(fileName);
+  if (fd >= 0) {
+    unlink(fileName);
+    fp = fdopen(fd, "w+b");
+    if (fp == NULL) {
+      close(fd);
+    }
+  }
+  free(fileName);
+#endif
+  if (fp == NULL) {
+    return false;
+  }
+  buffer = (char *)malloc(BUFFER_SIZE);
+  keySize = 256;
+  key = (char *)malloc(keySize);
+  return true;
+}
+
+void NgramRun::add(const char *newKey, size_t length, int newN,
+                   uint64_t newFrequency) {
+  size_t shared = 0;
+  size_t maxShared = length < keyLength ? length : keyLength;
+  while (shared < maxShared && newKey[shared] == key[shared]) {
+    shared++;
+  }
+  writeVarint(shared);
+  writeVarint(length - shared);
+  write(newKey + shared, length - shared);
+  writeVarint((uint64_t)newN);
+  writeVarint(newFrequency);
+
+  if (length > keySize) {
+    keySize = length * 2;
+    key = (char *)realloc(key, keySize);
+  }
+  memcpy(key + shared, newKey + shared, length - shared);
+  keyLength = length;
+}
+
+bool NgramRun::rewind() {
+  flush();
+  if (failed || fflush(fp) != 0 || fseek(fp, 0, SEEK_SET) != 0) {
+    return false;
+  }
+  bufferLength = 0;
+  bufferPos = 0;
+  keyLength = 0;
+  reading = true;
+  return true;
+}
+
+bool NgramRun::next() {
+  uint64_t shared;
+  uint64_t suffixLength;
+  uint64_t newN;
+  if (!readVarint(shared)) {
+    return false;
+  }
+  if (!readVarint(suffixLength) || shared > keyLength) {
+    return false;
+  }
+  size_t length = (size_t)(shared + suffixLength);
+  if (length > keySize) {
+    keySize = length * 2;
+    key = (char *)realloc(key, keySize);
+  }
+  if (!read(key + shared, (size_t)suffixLength) || !readVarint(newN) ||
+      !readVarint(frequency)) {
+    return false;
+  }
+  keyLength = length;
+  n = (int)newN;
+  return true;
+}
+
+int NgramRun::compare(const char *key1, size_t length1, int n1,
+                      const char *key2, size_t length2, int n2) {
+  int ret = memcmp(key1, key2, length1 < length2 ? length1 : length2);
+  if (ret != 0) {
+    return ret;
+  }
+  if (length1 != length2) {
+    return length1 < length2 ? -1 : 1;
+  }
+  return n1 - n2;
+}
+
+void NgramRun::write(const char *data, size_t length) {
+  while (length > 0) {
+    if (bufferLength == BUFFER_SIZE) {
+      flush();
+    }
+    size_t chunk = BUFFER_SIZE - bufferLength;
+    if (chunk > length) {
+      chunk = length;
+    }
+    memcpy(buffer + bufferLength, data, chunk);
+    bufferLength += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+}
+
+void NgramRun::writeVarint(uint64_t value) {
+  char bytes[10];
+  size_t length = 0;
+  while (value >= 0x80) {
+    bytes[length++] = (char)(value | 0x80);
+    value >>= 7;
+  }
+  bytes[length++] = (char)value;
+  write(bytes, length);
+}
+
+bool NgramRun::read(char *data, size_t length) {
+  while (length > 0) {
+    if (bufferPos == bufferLength) {
+      bufferLength = fread(buffer, 1, BUFFER_SIZE, fp);
+      bufferPos = 0;
+      if (bufferLength == 0) {
+        return false;
+      }
+    }
+    size_t chunk = bufferLength - bufferPos;
+    if (chunk > length) {
+      chunk = length;
+    }
+    memcpy(data, buffer + bufferPos, chunk);
+    bufferPos += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+  return true;
+}
+
+bool NgramRun::readVarint(uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    char byte;
+    if (!read(&byte, 1)) {
+      return false;
+    }
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void NgramRun::flush() {
+  if (bufferLength > 0 && !failed && !reading) {
+    size += bufferLength;
+    if (fwrite(buffer, 1, bufferLength, fp) != bufferLength) {
+      fprintf(stderr, "NgramRun:add - failed to write the run file\n");
+      failed = true;
+    }
+  }
+  bufferLength = 0;
+}
+
+/**
+ * orders runs by their current ngram, for a min heap
+ */
+static bool runGreater(const NgramRun *a, const NgramRun *b) {
+  return NgramRun::compare(a->getKey(), a->getKeyLength(), a->getN(),
+                           b->getKey(), b->getKeyLength(), b->getN()) > 0;
+}
+
+NgramRunMerger::~NgramRunMerger() {
+  for (size_t i = 0; i < runs.count(); i++) {
+    delete runs[i];
+  }
+  delete[] heap;
+}
+
+bool NgramRunMerger::rewind() {
+  bool ret = true;
+  delete[] heap;
+  heap = new NgramRun *[runs.count()];
+  heapSize = 0;
+  top = NULL;
+  for (size_t i = 0; i < runs.count(); i++) {
+    if (!runs[i]->rewind()) {
+      fprintf(stderr, "NgramRunMerger:rewind - failed to write a run file\n");
+      ret = false;
+    } else if (runs[i]->next()) {
+      heap[heapSize++] = runs[i];
+    }
+  }
+  std::make_heap(heap, heap + heapSize, runGreater);
+  return ret;
+}
+
+bool NgramRunMerger::next() {
+  // the run read last goes back into the heap at its next ngram
+  if (top && top->next()) {
+    heap[heapSize++] = top;
+    std::push_heap(heap, heap + heapSize, runGreater);
+  }
+  top = NULL;
+  if (heapSize == 0) {
+    return false;
+  }
+  std::pop_heap(heap, heap + heapSize, runGreater);
+  top = heap[--heapSize];
+  return true;
+}
+
+NgramRunSorter::NgramRunSorter(size_t newMemoryLimit)
+    : memoryLimit(newMemoryLimit), keys(NULL), keysLength(0), keysSize(0),
+      index(0) {
+  if (memoryLimit > 0 && memoryLimit < MIN_RUN_SIZE) {
+    memoryLimit = MIN_RUN_SIZE;
+  }
+}
+
+NgramRunSorter::~NgramRunSorter() { free(keys); }
+
+void NgramRunSorter::add(const char *key, size_t length, int n,
+                         uint64_t frequency) {
+  if (keysLength + length > keysSize) {
+    keysSize = std::max(std::max(keysSize * 2, keysLength + length),
+                        (size_t)MIN_KEYS_SIZE);
+    keys = (char *)realloc(keys, keysSize);
+  }
+  memcpy(keys + keysLength, key, length);
+  Item item;
+  item.keyOffset = keysLength;
+  item.keyLength = (uint32_t)length;
+  item.n = (uint32_t)n;
+  item.frequency = frequency;
+  items.add(item);
+  keysLength += length;
+  if (memoryLimit &&
+      keysLength + items.count() * sizeof(Item) > memoryLimit) {
+    this->spill();
+  }
+}
+
+bool NgramRunSorter::rewind() {
+  index = 0;
+  if (merger.count() == 0) {
+    this->sort();
+    return true;
+  }
+  if (items.count() > 0 && !this->spill()) {
+    return false;
+  }
+  return merger.rewind();
+}
+
+bool NgramRunSorter::next() {
+  if (merger.count() > 0) {
+    return merger.next();
+  }
+  if (index == items.count()) {
+    return false;
+  }
+  ++index;
+  return true;
+}
+
+const char *NgramRunSorter::getKey() const {
+  return merger.count() > 0 ? merger.getKey()
+                            : keys + items[index - 1].keyOffset;
+}
+
+size_t NgramRunSorter::getKeyLength() const {
+  return merger.count() > 0 ? merger.getKeyLength()
+                            : items[index - 1].keyLength;
+}
+
+int NgramRunSorter::getN() const {
+  return merger.count() > 0 ? merger.getN() : (int)items[index - 1].n;
+}
+
+uint64_t NgramRunSorter::getFrequency() const {
+  return merger.count() > 0 ? merger.getFrequency()
+                            : items[index - 1].frequency;
+}
+
+void NgramRunSorter::sort() {
+  const char *keys = this->keys;
+  std::sort(items.begin(), items.end(), [keys](const Item &a, const Item &b) {
+    return NgramRun::compare(keys + a.keyOffset, a.keyLength, a.n,
+                             keys + b.keyOffset, b.keyLength, b.n) < 0;
+  });
+}
+
+bool NgramRunSorter::spill() {
+  NgramRun *run = new NgramRun();
+  if (!run->create()) {
+    // sort on in memory
+    fprintf(stderr, "NgramRunSorter:spill - failed to create a run file\n");
+    delete run;
+    memoryLimit = 0;
+    return false;
+  }
+  this->sort();
+  for (size_t i = 0; i < items.count(); i++) {
+    run->add(keys + items[i].keyOffset, items[i].keyLength, items[i].n,
+             items[i].frequency);
+  }
+  merger.add(run);
+  items.resize(0);
+  keysLength = 0;
+  return true;
+}
@@ -0,0 +1,256 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/ngram_sort.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+
+template <class Function>
+void NgramSort::runThreads(int threads, Function function) {
+  if (threads == 1) {
+    function(0);
+    return;
+  }
+  std::thread *workers = new std::thread[threads];
+  for (int i = 0; i < threads; i++) {
+    workers[i] = std::thread(function, i);
+  }
+  for (int i = 0; i < threads; i++) {
+    workers[i].join();
+  }
+  delete[] workers;
+}
+
+uint64_t NgramSort::getPrefix(const char *ngram) {
+  uint64_t prefix = 0;
+  for (int i = 0; i < 8 && ngram[i]; i++) {
+    prefix |= (uint64_t)(unsigned char)ngram[i] << (56 - 8 * i);
+  }
+  return prefix;
+}
+
+bool NgramSort::ngramLess(const Key &a, const Key &b) {
+  if (a.prefix != b.prefix) {
+    return a.prefix < b.prefix;
+  }
+  return INgrams::FrequencyOrder()(a.token, b.token);
+}
+
+void NgramSort::sortByFrequency(
+    ngram_vector<INgrams::NgramToken *> &ngramVector, int threads) {
+  size_t count = ngramVector.count();
+  if (threads > (int)(count / MIN_THREAD_KEYS)) {
+    threads = (int)(count / MIN_THREAD_KEYS);
+  }
+  if (threads < 1) {
+    threads = 1;
+  }
+
+  Key *keys = new Key[count];
+  int64_t *minFrequencies = new int64_t[threads];
+  int64_t *maxFrequencies = new int64_t[threads];
+  runThreads(threads, [&](int t) {
+    size_t end = count * (t + 1) / threads;
+    int64_t minFrequency = INT64_MAX;
+    int64_t maxFrequency = INT64_MIN;
+    for (size_t i = count * t / threads; i < end; i++) {
+      INgrams::NgramToken *token = ngramVector[i];
+      Key &key = keys[i];
+      key.frequency = token->value.frequency;
+      key.prefix = getPrefix(token->ngram.c_str());
+      key.token = token;
+      minFrequency = std::min(minFrequency, key.frequency);
+      maxFrequency = std::max(maxFrequency, key.frequency);
+    }
+    minFrequencies[t] = minFrequency;
+    maxFrequencies[t] = maxFrequency;
+  });
+  int64_t minFrequency = *std::min_element(minFrequencies,
+                                           minFrequencies + threads);
+  int64_t maxFrequency = *std::max_element(maxFrequencies,
+                                           maxFrequencies + threads);
+  delete[] minFrequencies;
+  delete[] maxFrequencies;
+
+  if (threads == 1) {
+    std::sort(keys, keys + count, [](const Key &a, const Key &b) {
+      if (a.frequency != b.frequency) {
+        return a.frequency > b.frequency;
+      }
+      return ngramLess(a, b);
+    });
+  } else {
+    Key *buffer = new Key[count];
+    radixSort(keys, buffer, count, minFrequency, maxFrequency, threads);
+    sortRuns(keys, buffer, count, threads);
+    delete[] buffer;
+  }
+
+  runThreads(threads, [&](int t) {
+    size_t end = count * (t + 1) / threads;
+    for (size_t i = count * t / threads; i < end; i++) {
+      ngramVector[i] = keys[i].token;
+    }
+  });
+  delete[] keys;
+}
+
+void NgramSort::radixSort(Key *&keys, Key *&buffer, size_t count,
+                          int64_t minFrequency, int64_t maxFrequency,
+                          int threads) {
+  // the digits are of maxFrequency - frequency, so ascending digits give
+  // descending frequencies
+  uint64_t range = (uint64_t)(maxFrequency - minFrequency);
+  size_t *offsets = new size_t[threads * RADIX];
+  for (int shift = 0; shift < 64 && (range >> shift) > 0;
+       shift += RADIX_BITS) {
+    // count the digits of each thread's chunk
+    runThreads(threads, [&](int t) {
+      size_t *threadOffsets = offsets + t * RADIX;
+      std::fill(threadOffsets, threadOffsets + RADIX, 0);
+      size_t end = count * (t + 1) / threads;
+      for (size_t i = count * t / threads; i < end; i++) {
+        uint64_t digit = (uint64_t)(maxFrequency - keys[i].frequency);
+        ++threadOffsets[(digit >> shift) & (RADIX - 1)];
+      }
+    });
+    // each thread places its keys of a digit after those of the threads
+    // before it, so the pass is stable
+    size_t offset = 0;
+    for (int digit = 0; digit < RADIX; digit++) {
+      for (int t = 0; t < threads; t++) {
+        size_t digitCount = offsets[t * RADIX + digit];
+        offsets[t * RADIX + digit] = offset;
+        offset += digitCount;
+      }
+    }
+    runThreads(threads, [&](int t) {
+      size_t *threadOffsets = offsets + t * RADIX;
+      size_t end = count * (t + 1) / threads;
+      for (size_t i = count * t / threads; i < end; i++) {
+        uint64_t digit = (uint64_t)(maxFrequency - keys[i].frequency);
+        buffer[threadOffsets[(digit >> shift) & (RADIX - 1)]++] = keys[i];
+      }
+    });
+    std::swap(keys, buffer);
+  }
+  delete[] offsets;
+}
+
+void NgramSort::sortRuns(Key *keys, Key *buffer, size_t count, int threads) {
+  size_t *chunks = new size_t[threads + 1];
+  for (int t = 0; t <= threads; t++) {
+    chunks[t] = count * t / threads;
+  }
+
+  // each thread sorts the runs of a frequency in its chunk
+  runThreads(threads, [&](int t) {
+    size_t end = chunks[t + 1];
+    for (size_t start = chunks[t]; start < end;) {
+      size_t runEnd = start + 1;
+      while (runEnd < end && keys[runEnd].frequency == keys[start].frequency) {
+        ++runEnd;
+      }
+      std::sort(keys + start, keys + runEnd, ngramLess);
+      start = runEnd;
+    }
+  });
+
+  // a run cut by a chunk boundary is merged with its part in the next
+  // chunk, pairs of chunks are merged into twice as large chunks each round
+  ngram_vector<MergeTask> tasks;
+  for (int width = 1; width < threads; width *= 2) {
+    tasks.clear();
+    int mergeCount = 0;
+    for (int k = width; k < threads; k += 2 * width) {
+      size_t middle = chunks[k];
+      if (keys[middle - 1].frequency == keys[middle].frequency) {
+        ++mergeCount;
+      }
+    }
+    int parts = std::max(1, threads / std::max(1, mergeCount));
+    for (int k = width; k < threads; k += 2 * width) {
+      size_t middle = chunks[k];
+      int64_t frequency = keys[middle].frequency;
+      if (keys[middle - 1].frequency != frequency) {
+        continue;
+      }
+      Key *first = std::partition_point(
+          keys + chunks[k - width], keys + middle,
+          [frequency](const Key &key) { return key.frequency > frequency; });
+      Key *last = std::partition_point(
+          keys + middle, keys + chunks[std::min(k + width, threads)],
+          [frequency](const Key &key) { return key.frequency >= frequency; });
+      // split the merge at keys of the first range, the keys of the second
+      // range before them go to the part before
+      size_t start = first - keys;
+      size_t left = start;
+      size_t right = middle;
+      for (int p = 1; p <= parts; p++) {
+        MergeTask task;
+        task.left = left;
+        task.right = right;
+        task.out = left + right - middle;
+        if (p < parts) {
+          task.leftEnd = start + (middle - start) * p / parts;
+          task.rightEnd =
+              std::lower_bound(keys + right, last, keys[task.leftEnd],
+                               ngramLess) -
+              keys;
+        } else {
+          task.leftEnd = middle;
+          task.rightEnd = last - keys;
+        }
+        tasks.add(task);
+        left = task.leftEnd;
+        right = task.rightEnd;
+      }
+    }
+    if (tasks.count() == 0) {
+      continue;
+    }
+    int taskThreads = (int)std::min((size_t)threads, tasks.count());
+    runThreads(taskThreads, [&](int t) {
+      for (size_t i = t; i < tasks.count(); i += taskThreads) {
+        const MergeTask &task = tasks[i];
+        std::merge(keys + task.left, keys + task.leftEnd, keys + task.right,
+                   keys + task.rightEnd, buffer + task.out, ngramLess);
+      }
+    });
+    runThreads(taskThreads, [&](int t) {
+      for (size_t i = t; i < tasks.count(); i += taskThreads) {
+        const MergeTask &task = tasks[i];
+        size_t length =
+            (task.leftEnd - task.left) + (task.rightEnd - task.right);
+        std::copy(buffer + task.out, buffer + task.out + length,
+                  keys + task.out);
+      }
+    });
+  }
+  delete[] chunks;
+}
@@ -0,0 +1,71 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/config.h>
+#include <ngram/hash_ngram_table.h>
+#include <ngram/partitioned_ngram_table.h>
+#include <ngram/tst_ngram_table.h>
+
+NgramTable *NgramTable::create(int tableType, int partitions) {
+  if (partitions > 1) {
+    return new PartitionedNgramTable(partitions, tableType);
+  }
+  if (tableType == Config::HASH_TABLE) {
+    return new HashNgramTable();
+  }
+  return new TstNgramTable();
+}
+
+NgramTable::Cursor TstNgramTable::advance(Cursor cursor, const char *key,
+                                          size_t length) {
+  TernarySearchTree<NgramValue>::Cursor treeCursor = toTreeCursor(cursor);
+  const char *end = key + length;
+  while (key < end) {
+    const char *run = key;
+    while (key < end && (unsigned char)*key > ESCAPE) {
+      ++key;
+    }
+    treeCursor = tree.advance(treeCursor, run, key - run);
+    if (key < end) {
+      char escaped[2] = {(char)ESCAPE, (char)(*key + 1)};
+      treeCursor = tree.advance(treeCursor, escaped, 2);
+      ++key;
+    }
+  }
+  return (Cursor)(uintptr_t)treeCursor;
+}
+
+NgramTable::NgramValue *TstNgramTable::add(Cursor cursor, const char *key,
+                                           size_t length, int n,
+                                           bool &added) {
+  TernarySearchTree<NgramValue>::Cursor treeCursor = toTreeCursor(cursor);
+  NgramValue *value = tree.getValue(treeCursor);
+  added = value == NULL;
+  if (added) {
+    TstNode *node = tree.add(treeCursor, key, length, NgramValue(n, 0));
+    value = &tree.getItem(node->index)->value;
+  }
+  return value;
+}
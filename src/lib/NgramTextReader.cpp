@@ -0,0 +1,128 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/config.h>
+#include <ngram/ngram_text_reader.h>
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+NgramTextReader::NgramTextReader()
+    : begin(NULL), end(NULL), isByte(false), type(-1), n(0), total(0),
+      ngram(NULL), ngramLength(0), frequency(0), prunedCount(0) {}
+
+bool NgramTextReader::open(const char *fileName) {
+  begin = end = NULL;
+  isByte = false;
+  type = -1;
+  n = 0;
+  prunedCount = 0;
+  return reader.open(fileName);
+}
+
+int NgramTextReader::next() {
+  const char *text;
+  size_t length;
+  while (readLine(text, length)) {
+    // ngram lines are the most common, "ngram<tab>frequency"
+    const char *tab = text + length;
+    while (tab > text && tab[-1] != '\t') {
+      tab--;
+    }
+    if (tab-- > text && n > 0) {
+      char *numberEnd;
+      frequency = strtoll(tab + 1, &numberEnd, 10);
+      if (numberEnd == text + length && numberEnd > tab + 1) {
+        ngram = text;
+        ngramLength = tab - text;
+        return NGRAM;
+      }
+    }
+
+    utf8_string header;
+    header.append(text, length);
+    int order;
+    int64_t unique;
+    int64_t ngrams;
+    int64_t pruned;
+    if (header == "BEGIN OUTPUT BYTE NGRAMS") {
+      isByte = true;
+    } else if (sscanf(header.c_str(),
+                      "%d-GRAMS ( Total %" SCNd64 " unique ngrams in %" SCNd64
+                      " grams )",
+                      &order, &unique, &ngrams) == 3) {
+      // character or byte ngrams
+      type = isByte ? Config::BYTE_NGRAM : Config::CHAR_NGRAM;
+      n = order;
+      total = ngrams;
+      return ORDER;
+    } else if (sscanf(header.c_str(),
+                      "Total %" SCNd64 " unique ngrams in %" SCNd64 " %d-grams",
+                      &unique, &ngrams, &order) == 3) {
+      // word ngrams, after a "N-GRAMS" line
+      type = Config::WORD_NGRAM;
+      n = order;
+      total = ngrams;
+      return ORDER;
+    } else if (sscanf(header.c_str(),
+                      "Rare ngrams were pruned while counting, frequencies "
+                      "may be up to %" SCNd64 " too low",
+                      &pruned) == 1) {
+      prunedCount = pruned;
+    }
+  }
+  return END;
+}
+
+bool NgramTextReader::readLine(const char *&text, size_t &length) {
+  line.empty();
+  while (true) {
+    if (begin == end) {
+      if (!reader.read(begin, end)) {
+        // the last line may have no newline
+        text = line.c_str();
+        length = line.length();
+        return length > 0;
+      }
+    }
+    const char *newline = (const char *)memchr(begin, '\n', end - begin);
+    if (newline == NULL) {
+      line.append(begin, end - begin);
+      begin = end;
+      continue;
+    }
+    if (line.length() > 0) {
+      line.append(begin, newline - begin);
+      text = line.c_str();
+      length = line.length();
+    } else {
+      text = begin;
+      length = newline - begin;
+    }
+    begin = newline + 1;
+    return true;
+  }
+}
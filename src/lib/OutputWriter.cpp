@@ -0,0 +1,129 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/output_writer.h>
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+
+static int openFile(const char *fileName) {
+  return _open(fileName, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+               _S_IREAD | _S_IWRITE);
+}
+static int writeFile(int fd, const char *data, int length) {
+  return _write(fd, data, length);
+}
+static void closeFile(int fd) { _close(fd); }
+#else
+#include <unistd.h>
+
+static int openFile(const char *fileName) {
+  return open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+static int writeFile(int fd, const char *data, int length) {
+  return (int)write(fd, data, length);
+}
+static void closeFile(int fd) { close(fd); }
+#endif
+
+OutputWriter::OutputWriter()
+    : fd(-1), buffer(NULL), bufferLength(0), failed(false) {}
+
+bool OutputWriter::open(const char *fileName) {
+  close();
+  if (*fileName) {
+    fd = openFile(fileName);
+    if (fd < 0) {
+      return false;
+    }
+  } else {
+    // keep the order of anything printed to stdout before
+    fflush(stdout);
+    fd = STDOUT;
+  }
+  buffer = (char *)malloc(BUFFER_SIZE);
+  bufferLength = 0;
+  failed = false;
+  return true;
+}
+
+void OutputWriter::format(const char *format, ...) {
+  va_list args;
+  while (true) {
+    size_t room = BUFFER_SIZE - bufferLength;
+    va_start(args, format);
+    int length = vsnprintf(buffer + bufferLength, room, format, args);
+    va_end(args);
+    if (length < 0) {
+      return;
+    }
+    if ((size_t)length < room || bufferLength == 0) {
+      // text longer than the whole buffer is truncated
+      bufferLength += (size_t)length < room ? length : room - 1;
+      return;
+    }
+    flush();
+  }
+}
+
+void OutputWriter::flush() {
+  if (bufferLength > 0) {
+    writeAll(buffer, bufferLength);
+    bufferLength = 0;
+  }
+}
+
+void OutputWriter::writeAll(const char *data, size_t length) {
+  while (length > 0 && !failed) {
+    int chunk = length > (1 << 30) ? 1 << 30 : (int)length;
+    int written = writeFile(fd, data, chunk);
+    if (written <= 0) {
+      fprintf(stderr, "OutputWriter:write - failed to write the output\n");
+      failed = true;
+      return;
+    }
+    data += written;
+    length -= written;
+  }
+}
+
+void OutputWriter::close() {
+  if (fd < 0) {
+    return;
+  }
+  flush();
+  if (fd != STDOUT) {
+    closeFile(fd);
+  }
+  fd = -1;
+  free(buffer);
+  buffer = NULL;
+}
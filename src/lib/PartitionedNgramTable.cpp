@@ -0,0 +1,104 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/config.h>
+#include <ngram/partitioned_ngram_table.h>
+
+#include <algorithm>
+
+PartitionedNgramTable::PartitionedNgramTable(int partitionCount, int tableType)
+    : partitionCount(partitionCount),
+      hashPartitions(tableType == Config::HASH_TABLE), startsStale(false) {
+  partitions = new NgramTable *[partitionCount];
+  starts = new size_t[partitionCount + 1];
+  for (int i = 0; i < partitionCount; i++) {
+    partitions[i] = NgramTable::create(tableType);
+    starts[i] = 0;
+  }
+  starts[partitionCount] = 0;
+}
+
+PartitionedNgramTable::~PartitionedNgramTable() {
+  for (int i = 0; i < partitionCount; i++) {
+    delete partitions[i];
+  }
+  delete[] partitions;
+  delete[] starts;
+}
+
+size_t PartitionedNgramTable::count() const {
+  size_t total = 0;
+  for (int i = 0; i < partitionCount; i++) {
+    total += partitions[i]->count();
+  }
+  return total;
+}
+
+size_t PartitionedNgramTable::getMemoryUsage() const {
+  size_t total = 0;
+  for (int i = 0; i < partitionCount; i++) {
+    total += partitions[i]->getMemoryUsage();
+  }
+  return total;
+}
+
+void PartitionedNgramTable::reserve(size_t keyCount) {
+  // the keys spread evenly over the partitions, give each a little more for
+  // the chance of getting more than its share
+  size_t share = (keyCount + partitionCount - 1) / partitionCount;
+  for (int i = 0; i < partitionCount; i++) {
+    partitions[i]->reserve(share + share / 64 + 256);
+  }
+}
+
+void PartitionedNgramTable::updateStarts() {
+  for (int i = 0; i < partitionCount; i++) {
+    starts[i + 1] = starts[i] + partitions[i]->count();
+  }
+  startsStale.store(false, std::memory_order_relaxed);
+}
+
+NgramTable *PartitionedNgramTable::findItem(size_t &index) {
+  if (startsStale.load(std::memory_order_relaxed)) {
+    updateStarts();
+  }
+  // the first partition ending after the item, empty ones end where they
+  // start
+  size_t *end =
+      std::upper_bound(starts + 1, starts + partitionCount + 1, index);
+  int i = (int)(end - starts) - 1;
+  index -= starts[i];
+  return partitions[i];
+}
+
+const char *PartitionedNgramTable::getKey(size_t index, size_t &length) {
+  NgramTable *table = findItem(index);
+  return table->getKey(index, length);
+}
+
+NgramTable::NgramValue &PartitionedNgramTable::getValue(size_t index) {
+  NgramTable *table = findItem(index);
+  return table->getValue(index);
+}
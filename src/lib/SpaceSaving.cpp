@@ -0,0 +1,153 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#include <ngram/space_saving.h>
+
+#include <string.h>
+
+SpaceSaving::SpaceSaving(size_t newCapacity)
+    : capacity(newCapacity > 0 ? newCapacity : 1), entryCount(0) {
+  entries = new Entry[capacity];
+  heap = new size_t[capacity];
+  // at most half the slots are used
+  size_t slotCount = 16;
+  while (slotCount < capacity * 2) {
+    slotCount <<= 1;
+  }
+  slots = new size_t[slotCount];
+  memset(slots, 0, slotCount * sizeof(size_t));
+  slotMask = slotCount - 1;
+}
+
+SpaceSaving::~SpaceSaving() {
+  delete[] entries;
+  delete[] heap;
+  delete[] slots;
+}
+
+void SpaceSaving::add(const char *key, size_t length, uint64_t hash,
+                      int64_t frequency) {
+  size_t slot = findSlot(key, length, hash);
+  if (slots[slot]) {
+    Entry &entry = entries[slots[slot] - 1];
+    entry.count += frequency;
+    siftDown(entry.heapIndex);
+    return;
+  }
+
+  size_t index;
+  int64_t error = 0;
+  bool replaced = entryCount == capacity;
+  if (!replaced) {
+    index = entryCount++;
+    heap[index] = index;
+    entries[index].heapIndex = index;
+  } else {
+    // the least frequent key gives up its counter
+    index = heap[0];
+    Entry &least = entries[index];
+    removeSlot(findSlot(least.key.c_str(), least.key.length(), least.hash));
+    error = least.count;
+    slot = findSlot(key, length, hash);
+  }
+  Entry &entry = entries[index];
+  entry.key.empty();
+  entry.key.append(key, length);
+  entry.hash = hash;
+  entry.count = error + frequency;
+  entry.error = error;
+  slots[slot] = index + 1;
+  if (replaced) {
+    siftDown(entry.heapIndex);
+  } else {
+    siftUp(entry.heapIndex);
+  }
+}
+
+size_t SpaceSaving::findSlot(const char *key, size_t length,
+                             uint64_t hash) const {
+  size_t slot = hash & slotMask;
+  while (slots[slot]) {
+    const Entry &entry = entries[slots[slot] - 1];
+    if (entry.hash == hash && entry.key.length() == length &&
+        memcmp(entry.key.c_str(), key, length) == 0) {
+      break;
+    }
+    slot = (slot + 1) & slotMask;
+  }
+  return slot;
+}
+
+void SpaceSaving::removeSlot(size_t slot) {
+  size_t hole = slot;
+  for (size_t next = (slot + 1) & slotMask; slots[next];
+       next = (next + 1) & slotMask) {
+    // a key may move back into the hole if the hole is not before the slot
+    // it hashes to
+    size_t home = entries[slots[next] - 1].hash & slotMask;
+    if (((next - home) & slotMask) >= ((next - hole) & slotMask)) {
+      slots[hole] = slots[next];
+      hole = next;
+    }
+  }
+  slots[hole] = 0;
+}
+
+void SpaceSaving::siftUp(size_t position) {
+  size_t index = heap[position];
+  while (position > 0) {
+    size_t parent = (position - 1) / 2;
+    if (entries[heap[parent]].count <= entries[index].count) {
+      break;
+    }
+    heap[position] = heap[parent];
+    entries[heap[position]].heapIndex = position;
+    position = parent;
+  }
+  heap[position] = index;
+  entries[index].heapIndex = position;
+}
+
+void SpaceSaving::siftDown(size_t position) {
+  size_t index = heap[position];
+  while (true) {
+    size_t child = position * 2 + 1;
+    if (child >= entryCount) {
+      break;
+    }
+    if (child + 1 < entryCount &&
+        entries[heap[child + 1]].count < entries[heap[child]].count) {
+      ++child;
+    }
+    if (entries[index].count <= entries[heap[child]].count) {
+      break;
+    }
+    heap[position] = heap[child];
+    entries[heap[position]].heapIndex = position;
+    position = child;
+  }
+  heap[position] = index;
+  entries[index].heapIndex = position;
+}
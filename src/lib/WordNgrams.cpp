@@ -23,245 +23,297 @@ WebSite: http://www.cs.dal.ca/~zyu
 
 *************************************************************************/
 
+#include <ngram/hash_ngram_table.h>
 #include <ngram/word_ngrams.h>
 
+#include <algorithm>
+#include <cinttypes>
+
 WordNgrams::WordNgrams(int newNgramN, const char *newInFileName,
                        const char *newOutFileName, const char *newDelimiters,
-                       const char *newStopChars)
+                       const char *newStopChars,
+                       const NgramOptions &newOptions)
     : Ngrams(newNgramN, newInFileName, newOutFileName, newDelimiters,
-             newStopChars) {
-  addTokens();
+             newStopChars, newOptions),
+      parent(NULL), fileIds(NULL) {
+  partialToken.reserve(256);
+  if (newInFileName) {
+    addTokens();
+  }
 }
 
-WordNgrams::~WordNgrams() {}
-
-void WordNgrams::addTokens() {
-  // get token string from input file
-  auto &inFileName = getInFileName();
-  FILE *fp = inFileName.length() > 0 ? fopen(inFileName.c_str(), "r") : stdin;
-
-  if (fp == NULL) {
-    printf("WordNgrams:addTokens - failed to open file %s\n",
-           inFileName.c_str());
-  } else {
-    int count = 0;
-    char c;
-    bool isSpecialChar = false;
-    utf8_string token;
-    token.reserve(256);
-    while ((c = (char)fgetc(fp)) != EOF) {
-      if (isDelimiter(c) || isStopChar(c)) {
-        if (!isSpecialChar && token.length() > 0) {
-          this->addToken(token);
-          token.empty();
-          ++count;
-          isSpecialChar = true;
-        } else {
-          isSpecialChar = false;
-        }
+WordNgrams::WordNgrams(WordNgrams *parent)
+    : Ngrams(parent), parent(parent), fileIds(NULL) {
+  partialToken.reserve(256);
+}
 
-      } else {
-        token.append(c);
-        isSpecialChar = false;
+WordNgrams::~WordNgrams() { delete[] fileIds; }
+
+void WordNgrams::tokenize(const char *begin, const char *end) {
+  const char *tokenStart = begin;
+  for (const char *block = begin; block < end; block += ByteSet::BLOCK_SIZE) {
+    // a token ends at each bit set
+    uint32_t breaks = tokenBreaks.classify(block, end - block);
+    while (breaks) {
+      const char *p = block + ByteSet::lowestBit(breaks);
+      breaks &= breaks - 1;
+      if (partialToken.length() > 0) {
+        // the token started in an earlier block
+        partialToken.append(tokenStart, p - tokenStart);
+        this->addToken(partialToken.c_str(), partialToken.length());
+        partialToken.empty();
+      } else if (p > tokenStart) {
+        this->addToken(tokenStart, p - tokenStart);
       }
+      tokenStart = p + 1;
     }
-    if (token.length() > 0) {
-      ++count;
-      this->addToken(token);
-    }
-    // special processing need to be done, if less than NGRAM_N tokens in the
-    // whole input text.
-    if (count < this->getN()) {
-      preParse(count);
-    }
+  }
+  if (tokenStart < end) {
+    partialToken.append(tokenStart, end - tokenStart);
+  }
+}
 
-    fclose(fp);
+void WordNgrams::finishTokens() {
+  if (partialToken.length() > 0) {
+    this->addToken(partialToken.c_str(), partialToken.length());
+    partialToken.empty();
   }
 }
 
-void WordNgrams::addToken(const utf8_string &token) {
-  char buff[32];
+const char *WordNgrams::findShardStart(const char *p, const char *end) const {
+  while (p < end && !tokenBreaks.contains(p[-1])) {
+    p++;
+  }
+  return p;
+}
 
-  this->encodeInteger(
-      this->AddToWordTable(token.isNumber() ? "<NUMBER>" : token.c_str()),
-      ENCODE_BASE, buff);
+void WordNgrams::merge(Ngrams &shard) {
+  WordNgrams &words = static_cast<WordNgrams &>(shard);
+  size_t wordCount = words.wordTable.count();
+  uint32_t *ids = new uint32_t[wordCount];
+  for (size_t i = 0; i < wordCount; i++) {
+    const char *word = words.wordTable.getKey(i);
+    ids[i] = this->AddToWordTable(word, strlen(word));
+  }
 
-  this->Ngrams::addToken(buff);
+  uint32_t *key = new uint32_t[ngramN];
+  size_t count = words.ngramTable->count();
+  for (size_t i = 0; i < count; i++) {
+    NgramValue &value = words.ngramTable->getValue(i);
+    size_t length;
+    const char *shardKey = words.ngramTable->getKey(i, length);
+    for (int j = 0; j < value.n; j++) {
+      uint32_t id;
+      memcpy(&id, shardKey + j * sizeof(id), sizeof(id));
+      key[j] = ids[id];
+    }
+    this->addNgram((const char *)key, length, value.n, value.frequency);
+  }
+  delete[] key;
+  delete[] ids;
 }
 
-void WordNgrams::preParse(int count) {
-  TokenNode *p, *newHead;
-  p = newHead = head;
-  utf8_string ngram;
-  ngram.reserve(256);
-  while (newHead) {
-    p = newHead;
-    ngram.empty();
-    for (unsigned short i = 0; i < count; i++) {
-      ngram += p->token;
-      // printf("%d ngram %s.\n", i, ngram.c_str() );
-      this->addNgram(ngram.c_str(), i + 1);
-      if (p == tail) {
-        break;
-      } else {
-        ngram += ENCODE_WORD_DELIMITER;
-      }
-      p = p->next;
-    }
-    newHead = newHead->next;
+void WordNgrams::addToken(const utf8_string &token) {
+  this->addToken(token.c_str(), token.length());
+}
+
+void WordNgrams::addToken(const char *token, size_t length) {
+  size_t i = 0;
+  while (i < length && isdigit((unsigned char)token[i])) {
+    i++;
+  }
+  if (this->isEstimatingUniques()) {
+    // words are told apart by their hash, no word table is kept
+    uint64_t hash = i == length ? HashNgramTable::hash("<NUMBER>", 8)
+                                : HashNgramTable::hash(token, length);
+    this->Ngrams::addToken((const char *)&hash, sizeof(hash));
+    return;
   }
+  uint32_t id = i == length ? this->AddToWordTable("<NUMBER>", 8)
+                            : this->AddToWordTable(token, length);
+
+  this->Ngrams::addToken((const char *)&id, sizeof(id));
 }
 
-void WordNgrams::parse() {
-  TokenNode *p, *newHead;
-  p = newHead = head;
-  utf8_string ngram;
-  ngram.reserve(256);
-  while (newHead) {
-    unsigned short n = 0;
-    p = newHead;
-    ngram.empty();
-    while (p) {
-      ngram += p->token;
-      ++n;
-      p = p->next;
-      if (p)
-        ngram += ENCODE_WORD_DELIMITER;
-    }
-    // printf("%d ngram %s.\n", n, ngram.c_str() );
-    if (n > 0) {
-      this->addNgram(ngram.c_str(), n);
-    }
-    newHead = newHead->next;
+void WordNgrams::feedTokens(const char *const *tokens, const size_t *lengths,
+                            size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    this->addToken(tokens[i], lengths[i]);
   }
 }
 
-unsigned WordNgrams::AddToWordTable(const char *word) {
-  unsigned id;
-  unsigned *value = wordTable.getValue(word);
+unsigned WordNgrams::AddToWordTable(const char *word, size_t length) {
+  TernarySearchTree<unsigned>::Cursor cursor =
+      wordTable.advance(wordTable.getCursor(), word, length);
+  unsigned *value = wordTable.getValue(cursor);
   if (value) {
-    id = *value;
+    return *value;
+  }
+  unsigned id;
+  if (isRouted()) {
+    std::lock_guard<std::mutex> lock(parent->wordTableLock);
+    id = parent->AddToWordTable(word, length);
   } else {
-    id = wordTable.count();
-    wordTable.add(word, id);
+    id = (unsigned)wordTable.count();
   }
+  wordTable.add(cursor, word, length, id);
   return id;
 }
 
-void WordNgrams::output() {
+void WordNgrams::outputText() {
   int ngramN = this->getN();
+  OutputWriter out;
+  if (!out.open(getOutFileName().c_str())) {
+    printf("WordNgrams:output - failed to open file %s\n",
+           getOutFileName().c_str());
+    return;
+  }
 
-  printf("BEGIN OUTPUT\n");
-  printf("Total %d unique ngram in %d ngrams.\n", this->count(), this->total());
-  fprintf(stderr, "Total %d unique ngram in %d ngrams.\n", this->count(),
-          this->total());
+  out.write("BEGIN OUTPUT\n");
+  out.format("Total %" PRId64 " unique ngram in %" PRId64 " ngrams.\n",
+             this->count(), this->total());
+  fprintf(stderr, "Total %" PRId64 " unique ngram in %" PRId64 " ngrams.\n",
+          this->count(), this->total());
+  if (this->getPrunedCount()) {
+    out.format("Rare ngrams were pruned while counting, frequencies may be "
+               "up to %" PRId64 " too low.\n",
+               this->getPrunedCount());
+  }
+  this->writeApproximation(out);
 
   for (int i = 1; i <= ngramN; i++) {
-    // Get sorted item list
-    ngram_vector<NgramToken *> ngramVector;
-    this->getNgrams(ngramVector, i);
-
-    printf("\n%d-GRAMS\n", i);
-    printf("Total %d unique ngrams in %d %d-grams.\n", this->count(i),
-           this->total(i), i);
-    fprintf(stderr, "Total %d unique ngrams in %d %d-grams.\n", this->count(i),
-            this->total(i), i);
-    printf("------------------------\n");
-
-    size_t count = ngramVector.count();
-    ngramVector.sort(INgrams::compareFunction);
-
-    for (unsigned j = 0; j < count; j++) {
-      NgramToken *ngramToken = ngramVector[j];
-      // outputWordNgram( ngramToken.ngram, ngramToken.value.frequency, i );
-      printf("%s\t%d\n", ngramToken->ngram.c_str(),
-             ngramToken->value.frequency);
-      delete ngramToken;
-    }
+    out.format("\n%d-GRAMS\n", i);
+    out.format("Total %" PRId64 " unique ngrams in %" PRId64 " %d-grams.\n",
+               this->count(i), this->total(i), i);
+    fprintf(stderr,
+            "Total %" PRId64 " unique ngrams in %" PRId64 " %d-grams.\n",
+            this->count(i), this->total(i), i);
+    out.write("------------------------\n");
+    this->writeNgrams(out, i);
   }
 }
 
-void WordNgrams::getNgrams(ngram_vector<NgramToken *> &ngramVector, int n) {
-
-  // Get sorted item list
-  ngram_vector<TstItem<NgramValue> *> &itemVector = this->getItems();
-  size_t count = itemVector.count();
-  utf8_string decodedKey;
-  decodedKey.reserve(256);
-  for (unsigned i = 0; i < count; i++) {
-    TstItem<NgramValue> *item = itemVector[i];
-    if (item->value.n == n) {
-      // decode the key to readable string
-      decodedKey.empty();
-      this->decodeWordNgram(item->key, n, decodedKey);
-      ngramVector.add(new NgramToken(decodedKey, item->value));
-      // ngramVector.add( NgramToken( decodedKey, item->value ) );
+void WordNgrams::decodeWordNgram(const char *ngram, int n,
+                                 utf8_string &decodedNgram) {
+  for (int i = 0; i < n; i++) {
+    uint32_t id;
+    memcpy(&id, ngram + i * sizeof(id), sizeof(id));
+    decodedNgram += this->wordTable.getKey((int)id);
+    if (i < n - 1) {
+      decodedNgram.append('_');
     }
   }
 }
 
-void WordNgrams::encodeInteger(int num, int bas, char *buff) {
-  unsigned short index = 0;
-  int rem;
-
-  while (num >= bas) {
-    rem = num % bas;
-    // rem = rem == 0 ? ENCODE_NULL : rem;
-    if (!rem) {
-      rem = ENCODE_NULL;
-    }
-    num /= bas;
-    sprintf(buff + index++, "%c", rem);
+void WordNgrams::writeVocabulary(NgramFileWriter &writer) {
+  int wordCount = wordTable.count();
+  int *sorted = new int[wordCount];
+  for (int i = 0; i < wordCount; i++) {
+    sorted[i] = i;
   }
-
-  if (!num) {
-    num = ENCODE_NULL;
+  std::sort(sorted, sorted + wordCount, [this](int a, int b) {
+    return strcmp(wordTable.getKey(a), wordTable.getKey(b)) < 0;
+  });
+  delete[] fileIds;
+  fileIds = new uint32_t[wordCount];
+  for (int i = 0; i < wordCount; i++) {
+    const char *word = wordTable.getKey(sorted[i]);
+    writer.addWord(word, strlen(word));
+    fileIds[sorted[i]] = (uint32_t)i;
   }
-  sprintf(buff + index, "%c%c", num, '\0');
+  delete[] sorted;
 }
 
-int WordNgrams::decodeInteger(unsigned char *buffer, int bas) {
-  int num = 0, accumulate = 1;
-  unsigned short index = 0;
-  unsigned char c;
-  while ((c = buffer[index]) != 0) {
-    // printf("%d.", c );
-    if (index++ > 0) {
-      accumulate *= bas;
-    }
+void WordNgrams::encodeFileKey(const char *key, size_t length, int n,
+                               utf8_string &fileKey) {
+  for (int i = 0; i < n; i++) {
+    uint32_t id;
+    memcpy(&id, key + i * sizeof(id), sizeof(id));
+    char fileId[4];
+    NgramFileWriter::encodeWordKey(&fileIds[id], 1, fileId);
+    fileKey.append(fileId, sizeof(fileId));
+  }
+}
 
-    if (c == WordNgrams::ENCODE_WORD_DELIMITER) {
-      break;
+bool WordNgrams::decodeFileKey(const NgramFileReader &reader,
+                               const char *fileKey, size_t length, int n,
+                               utf8_string &key) {
+  for (int i = 0; i < n; i++) {
+    const unsigned char *p = (const unsigned char *)fileKey + i * 4;
+    uint32_t fileId = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+                      (uint32_t)p[2] << 8 | p[3];
+    size_t wordLength;
+    const char *word = reader.getWord(fileId, wordLength);
+    if (word == NULL) {
+      return false;
     }
-
-    num += (c == ENCODE_NULL ? 0 : c) * accumulate;
+    uint32_t id = this->AddToWordTable(word, wordLength);
+    key.append((const char *)&id, sizeof(id));
   }
-  // printf("\n");
-  return num;
+  return true;
 }
 
-void WordNgrams::decodeWordNgram(const utf8_string &ngram, int n,
-                                 utf8_string &decodedNgram) {
-  // printf("outputWordNgram %s.\n", ngram.c_str() );
-  int index = 0;
-  int loop = 0;
-  const unsigned char *p = (unsigned char *)ngram.c_str();
-  unsigned char buff[32];
-
-  while (loop++ < n) {
-    while (*p != WordNgrams::ENCODE_WORD_DELIMITER && *p != '\0') {
-      buff[index++] = (unsigned char)*p++;
+bool WordNgrams::encodeNgram(const char *ngram, size_t length, int n,
+                             utf8_string &key) {
+  const char *end = ngram + length;
+  const char **wordEnds = new const char *[n];
+  int splits = 0;
+  if (n == 1) {
+    wordEnds[0] = end;
+    splits = 1;
+  } else {
+    int separators = 0;
+    for (const char *p = ngram; p < end; p++) {
+      if (*p == '_') {
+        if (separators < n - 1) {
+          wordEnds[separators] = p;
+        }
+        ++separators;
+      }
     }
+    if (separators == n - 1) {
+      wordEnds[n - 1] = end;
+      splits = 1;
+    } else if (separators > n - 1) {
+      splits = this->splitNgram(ngram, end, n, wordEnds);
+    }
+  }
 
-    ++p;
-
-    buff[index] = '\0';
-    index = 0;
-    // printf("ID -- %d.\n", decodeInteger( buff, ENCODE_BASE ) );
+  if (splits == 1) {
+    const char *word = ngram;
+    for (int i = 0; i < n; i++) {
+      uint32_t id = this->AddToWordTable(word, wordEnds[i] - word);
+      key.append((const char *)&id, sizeof(id));
+      word = wordEnds[i] + 1;
+    }
+  }
+  delete[] wordEnds;
+  return splits == 1;
+}
 
-    decodedNgram += this->wordTable.getKey(decodeInteger(buff, ENCODE_BASE));
-    if (loop < n) {
-      decodedNgram.append('_');
+int WordNgrams::splitNgram(const char *ngram, const char *end, int n,
+                           const char **wordEnds) {
+  if (n == 1) {
+    wordEnds[0] = end;
+    return isKnownWord(ngram, end - ngram) ? 1 : 0;
+  }
+  int splits = 0;
+  for (const char *p = ngram;
+       splits < 2 && (p = (const char *)memchr(p, '_', end - p)) != NULL;
+       p++) {
+    if (isKnownWord(ngram, p - ngram)) {
+      int restSplits = this->splitNgram(p + 1, end, n - 1, wordEnds + 1);
+      if (restSplits > 0 && splits == 0) {
+        wordEnds[0] = p;
+      }
+      splits += restSplits;
     }
   }
+  return splits;
+}
+
+bool WordNgrams::isKnownWord(const char *word, size_t length) {
+  return length > 0 &&
+         wordTable.getValue(wordTable.advance(wordTable.getCursor(), word,
+                                              length)) != NULL;
 }
@@ -29,7 +29,10 @@ WebSite: http://www.cs.dal.ca/~zyu
 #include <ngram/ngrams.h>
 
 /**
- * this class implements all byte(unsigned char) ngram related operations
+ * this class implements all byte(unsigned char) ngram related operations.
+ * A ngram key is its raw bytes, written as hex digit pairs only in the text
+ * output. The 1-grams and 2-grams are counted in an array of 65536 + 256
+ * counters.
  * Revisions:
  * Feb 18, 2006. Jerry Yu
  * Initial implementation
@@ -39,38 +42,35 @@ class ByteNgrams : public Ngrams {
 public:
   ByteNgrams(int newNgramN, const char *newInFileName,
              const char *newOutFileName, const char *newDelimiters = "",
-             const char *newStopChars = "");
+             const char *newStopChars = "",
+             const NgramOptions &newOptions = NgramOptions());
 
   virtual ~ByteNgrams();
 
-  void addTokens();
-
+protected:
   /**
    * sort ngrams by frequency/ngram/or both, then output
    */
-  void output();
+  void outputText();
 
-private:
-  /**
-   * Generate ngrams when queue has NGRAM_N - 1 tokens.
-   * the token queue need to be processed specially for the first NGRAM_N - 1
-   * tokens, also need to be called if less than NGRAM_N tokens in the whole
-   * input text.
-   * @param	count - total items in the queue
-   */
-  void preParse(int count);
+  int getType() const { return Config::BYTE_NGRAM; }
 
   /**
-   * Once the queue is full, it will start to pop out ngrams
-   * for each new token pushing in
+   * create an empty shard with the settings of parent
    */
+  explicit ByteNgrams(const ByteNgrams *parent) : Ngrams(parent) {
+    this->enableDirectCounts(2);
+  }
 
-  void parse();
+  void tokenize(const char *begin, const char *end);
+
+  Ngrams *createShard() { return new ByteNgrams(this); }
 
   /**
-   * get all ngrams for given N
-   * @return total number of ngrams for the N
+   * the hex digit pairs of the key bytes
    */
-  void getNgrams(ngram_vector<NgramToken *> &ngramVector, int n);
+  void decodeNgram(const char *key, size_t length, int n, utf8_string &ngram);
+
+  bool encodeNgram(const char *ngram, size_t length, int n, utf8_string &key);
 };
 #endif
@@ -0,0 +1,109 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _BYTE_SET_H_
+#define _BYTE_SET_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * A set of byte values, such as the delimiters of a tokenizer, looked up in a
+ * 256 entry table. Blocks of input are classified BLOCK_SIZE bytes at a time
+ * into a bitmask of the bytes in the set, with AVX2 or SSSE3 when the build
+ * targets them, so a tokenizer can jump from one delimiter to the next by
+ * scanning the bits.
+ */
+class ByteSet {
+public:
+  enum { BLOCK_SIZE = 32 }; // bytes classified at a time
+
+  ByteSet() { clear(); }
+
+  /**
+   * remove all bytes from the set
+   */
+  void clear();
+
+  /**
+   * add a byte to the set
+   */
+  void add(unsigned char c);
+
+  /**
+   * add the chars of a null terminated string to the set, not the null
+   */
+  void add(const char *chars);
+
+  /**
+   * add all bytes of another set
+   */
+  void add(const ByteSet &other);
+
+  /**
+   * true if the byte is in the set
+   * @param	c - a char, or an int holding an unsigned char value
+   */
+  bool contains(int c) const { return members[(unsigned char)c] != 0; }
+
+  /**
+   * classify up to BLOCK_SIZE bytes
+   * @param	p - first byte
+   * @param	length - bytes to classify, only the first BLOCK_SIZE of them
+   *		are when there are more
+   * @return	bit i set if p[ i ] is in the set
+   */
+  uint32_t classify(const char *p, size_t length) const;
+
+  /**
+   * get the index of the lowest bit set in a non zero mask
+   */
+  static int lowestBit(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+
+private:
+  unsigned char members[256]; // 1 for the bytes in the set
+
+  /**
+   * The vector kernels look a byte up by its low nibble in lowNibbles[ 0 ]
+   * for bytes below 0x80, lowNibbles[ 1 ] for the others, giving a mask of
+   * the high nibbles ( modulo 8 ) of the bytes in the set with that low
+   * nibble.
+   */
+  unsigned char lowNibbles[2][16];
+};
+
+#endif
@@ -29,7 +29,10 @@ WebSite: http://www.cs.dal.ca/~zyu
 #include <ngram/ngrams.h>
 
 /**
- * this class implements all character ngram related operations
+ * this class implements all character ngram related operations. The input is
+ * read as UTF-8, each char ( code point ) mapped to upper case is a token, and
+ * a ngram key is the UTF-8 of its chars. Each invalid byte is read as
+ * U+FFFD.
  * Revisions:
  * Feb 18, 2006. Jerry Yu
  * Initial implementation
@@ -41,39 +44,49 @@ public:
   CharNgrams(int newNgramN, const char *newInFileName,
              const char *newOutFileName,
              const char *newDelimiters = Config::getDefaultDelimiters(),
-             const char *newStopChars = Config::getDefaultStopChars());
+             const char *newStopChars = Config::getDefaultStopChars(),
+             const NgramOptions &newOptions = NgramOptions());
 
   virtual ~CharNgrams();
 
-  void addTokens();
-
+protected:
   /**
    * sort ngrams by frequency/ngram/or both, then output
    */
+  void outputText();
 
-  void output();
+  int getType() const { return Config::CHAR_NGRAM; }
 
-private:
   /**
-   * Generate ngrams when queue has NGRAM_N - 1 tokens.
-   * the token queue need to be processed specially for the first NGRAM_N - 1
-   * tokens, also need to be called if less than NGRAM_N tokens in the whole
-   * input text.
-   * @param	count - total items in the queue
+   * create an empty shard with the settings of parent
    */
-  void preParse(int count);
+  explicit CharNgrams(const CharNgrams *parent);
+
+  void tokenize(const char *begin, const char *end);
+
+  void finishTokens();
+
+  Ngrams *createShard() { return new CharNgrams(this); }
 
   /**
-   * Once the queue is full, it will start to pop out ngrams
-   * for each new token pushing in
+   * a chunk starts at a char, after a char that is not a delimiter
    */
+  const char *findShardStart(const char *p, const char *end) const;
 
-  void parse();
+private:
+  bool isSpecialChar; // whether the last char fed in was a delimiter
+  char pending[4];    // a sequence cut by the end of the last block
+  int pendingLength;  // bytes in pending
+
+  /**
+   * feed in a char, a run of delimiters as one '_' token
+   */
+  void addChar(uint32_t c);
 
   /**
-   * get all ngrams for given N
-   * @return total number of ngrams for the N
+   * read the rest of the pending sequence from a block
+   * @return	where the block goes on
    */
-  void getNgrams(ngram_vector<NgramToken *> &ngramVector, int n);
+  const char *completePending(const char *begin, const char *end);
 };
 #endif
@@ -33,6 +33,7 @@ WebSite: http://www.cs.dal.ca/~zyu
 #ifndef NGRAM_CONFIG_H
 #define NGRAM_CONFIG_H
 
+#include <ngram/ngram_vector.h>
 #include <ngram/utf8_string.h>
 
 class Config {
@@ -52,6 +53,33 @@ public:
 
   enum { DEFAULT_NGRAM_N = 3 };
 
+  enum {
+    // ternary search tree
+    TST_TABLE,
+    // open addressing hash table
+    HASH_TABLE
+  };
+
+  enum {
+    DEFAULT_TABLE_TYPE = HASH_TABLE // default ngram table type
+  };
+
+  enum {
+    // ngram and frequency lines
+    TEXT_FORMAT,
+    // binary ngram count file, see ngram_file.h
+    BINARY_FORMAT
+  };
+
+  enum {
+    // a table entry for each ngram
+    EXACT_COUNTS,
+    // a Count-Min Sketch and the heavy hitters of each N
+    COUNT_MIN_SKETCH,
+    // HyperLogLog estimates of the unique ngrams of each N, no ngrams kept
+    HYPER_LOG_LOG
+  };
+
   /**
    * get the default delimiters
    */
@@ -109,4 +137,53 @@ public:
   }
 };
 
+/**
+ * options controlling how ngrams are counted
+ */
+struct NgramOptions {
+  int tableType; // Config::TST_TABLE or Config::HASH_TABLE
+  int threads;    // threads counting a memory mapped input and sorting the
+                  // output, 1 for none
+  int partitions; // hash partitions of the table, each filled by a thread
+  ngram_vector<int> top; // most frequent ngrams output, for all N or each N
+  int minCount;          // least frequency of the ngrams output
+  size_t maxMemory; // bytes of table, above which rare ngrams are pruned, 0
+                    // for no pruning
+  int format;       // Config::TEXT_FORMAT or Config::BINARY_FORMAT
+  size_t memoryLimit; // bytes of table, above which it is spilled to a run
+                      // file, 0 for counting in memory only
+  bool documentBoundaries; // whether each input file is a document, which no
+                           // ngram spans
+  int approximation;       // Config::EXACT_COUNTS, COUNT_MIN_SKETCH or
+                           // HYPER_LOG_LOG
+  size_t sketchWidth;      // counters per row of the sketch
+  int sketchDepth;         // rows of the sketch
+  size_t heavyHitters;     // most frequent ngrams of each N kept with a sketch
+  int uniquesPrecision;    // bits of the hash picking a HyperLogLog register
+  size_t expectedUniques;  // unique ngrams of all N the table is sized for
+                           // up front, 0 for none
+  bool sampleUniques;      // whether expectedUniques is instead estimated
+                           // from a sample of the input files
+
+  NgramOptions()
+      : tableType(Config::DEFAULT_TABLE_TYPE), threads(1), partitions(1),
+        minCount(1), maxMemory(0), format(Config::TEXT_FORMAT),
+        memoryLimit(0), documentBoundaries(false),
+        approximation(Config::EXACT_COUNTS), sketchWidth(1 << 20),
+        sketchDepth(4), heavyHitters(10000), uniquesPrecision(14),
+        expectedUniques(0), sampleUniques(false) {}
+
+  /**
+   * get how many of the most frequent ngrams of given N are output
+   * @return	the one top value, the value for N if one is given per N, or 0
+   *		for all ngrams
+   */
+  int getTop(int n) const {
+    if (top.count() == 1) {
+      return top[0];
+    }
+    return n <= (int)top.count() ? top[n - 1] : 0;
+  }
+};
+
 #endif
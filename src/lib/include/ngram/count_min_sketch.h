@@ -0,0 +1,117 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _COUNT_MIN_SKETCH_H_
+#define _COUNT_MIN_SKETCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Count-Min Sketch with conservative update, approximate frequencies of
+ * ngrams in fixed memory.
+ *
+ * The counters are depth rows of width counters, width a power of 2, each
+ * row 64 bytes aligned and back to back in one block. A key is hashed once,
+ * its column in row i is h1 + i * h2 of the two halves of the hash. The
+ * estimate of a key is its smallest counter, and an update only raises the
+ * counters below the new estimate, so estimates are never too low, and too
+ * high by at most e / width of the total with probability 1 - e^-depth.
+ */
+class CountMinSketch {
+public:
+  /**
+   * @param	width - counters per row, rounded up to a power of 2
+   * @param	depth - number of rows
+   */
+  CountMinSketch(size_t width, int depth);
+
+  ~CountMinSketch();
+
+  /**
+   * add frequency to the key of given hash
+   * @return	the new estimate of the key
+   */
+  int64_t add(uint64_t hash, int64_t frequency);
+
+  /**
+   * get the estimated frequency of the key of given hash
+   */
+  int64_t estimate(uint64_t hash) const;
+
+  /**
+   * get the most an estimate may be too high, with probability
+   * getConfidence(), after total occurrences of keys were added
+   */
+  int64_t getErrorBound(int64_t total) const;
+
+  /**
+   * get the probability that an estimate is within getErrorBound()
+   */
+  double getConfidence() const;
+
+  size_t getWidth() const { return width; }
+
+  int getDepth() const { return depth; }
+
+  size_t getMemoryUsage() const { return width * depth * sizeof(int64_t); }
+
+private:
+  enum { MAX_DEPTH = 32 };
+
+  char *counterBlock; // allocation holding counters
+  int64_t *counters;  // depth rows of width counters, 64 bytes aligned
+  size_t width;       // counters per row, power of 2
+  int depth;          // number of rows
+
+  /**
+   * get the counter index of the key in each row
+   */
+  void getColumns(uint64_t hash, size_t *columns) const {
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    for (int i = 0; i < depth; i++) {
+      columns[i] = i * width + ((h1 + (size_t)i * h2) & (width - 1));
+    }
+  }
+
+  /**
+   * get the smallest counter of given columns
+   */
+  int64_t getMinimum(const size_t *columns) const {
+    int64_t minimum = INT64_MAX;
+    for (int i = 0; i < depth; i++) {
+      if (counters[columns[i]] < minimum) {
+        minimum = counters[columns[i]];
+      }
+    }
+    return minimum;
+  }
+
+  CountMinSketch(const CountMinSketch &);
+  void operator=(const CountMinSketch &);
+};
+
+#endif
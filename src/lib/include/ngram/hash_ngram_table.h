@@ -0,0 +1,164 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _HASH_NGRAM_TABLE_H_
+#define _HASH_NGRAM_TABLE_H_
+
+#include <ngram/ngram_table.h>
+#include <ngram/ngram_vector.h>
+
+/**
+ * Open addressing hash table for ngrams.
+ *
+ * Items ( hash, key, value ) are kept densely in insertion order. Keys up to
+ * 16 bytes ( eg. word 4-grams of 32 bits ids ) are stored packed in the item
+ * itself, longer keys are copied into large arena blocks. The index is an
+ * array of one control byte per slot ( EMPTY, or 7 bits of the key hash )
+ * plus the 32 bits item number of the slot, so a table holds up to 2^32
+ * items. Slots are probed a group of 16 control
+ * bytes at a time, compared against the hash bits with SSE2 when available,
+ * so a lookup touches the items of matching slots only.
+ *
+ * Cursors are the running FNV-1a hash of the key bytes walked so far.
+ */
+class HashNgramTable : public NgramTable {
+public:
+  HashNgramTable();
+
+  virtual ~HashNgramTable();
+
+  Cursor getCursor() { return FNV_OFFSET_BASIS; }
+
+  Cursor advance(Cursor cursor, const char *key, size_t length) {
+    const unsigned char *p = (const unsigned char *)key;
+    for (size_t i = 0; i < length; i++) {
+      cursor = (cursor ^ p[i]) * FNV_PRIME;
+    }
+    return cursor;
+  }
+
+  NgramValue *add(Cursor cursor, const char *key, size_t length, int n,
+                  bool &added);
+
+  size_t count() const { return items.count(); }
+
+  const char *getKey(size_t index, size_t &length) {
+    Item &item = items[index];
+    length = item.length;
+    return item.getKey();
+  }
+
+  NgramValue &getValue(size_t index) { return items[index].value; }
+
+  size_t getMemoryUsage() const {
+    return items.capacity() * sizeof(Item) +
+           capacity * (1 + sizeof(uint32_t)) +
+           arenaBlocks.count() * ARENA_BLOCK_SIZE;
+  }
+
+  void reserve(size_t keyCount);
+
+  static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+  static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+  /**
+   * finalize the running FNV hash so both low and high bits are usable
+   */
+  static uint64_t mix(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  /**
+   * get the mixed hash of a whole key, as the sketches take it
+   */
+  static uint64_t hash(const char *key, size_t length) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    const unsigned char *p = (const unsigned char *)key;
+    for (size_t i = 0; i < length; i++) {
+      hash = (hash ^ p[i]) * FNV_PRIME;
+    }
+    return mix(hash);
+  }
+
+private:
+  // items addressed by the 32 bits item numbers of the slots
+  static const size_t MAX_ITEMS = (size_t)UINT32_MAX + 1;
+
+  enum {
+    GROUP_SIZE = 16,           // slots probed at once
+    INLINE_KEY_SIZE = 16,      // longest key stored in the item
+    EMPTY = 0x80,              // control byte of an empty slot
+    MIN_CAPACITY = 1024,       // initial number of slots
+    ARENA_BLOCK_SIZE = 1 << 20 // bytes per key arena block
+  };
+
+  struct Item {
+    uint64_t hash;
+    union {
+      char bytes[INLINE_KEY_SIZE]; // key up to INLINE_KEY_SIZE bytes
+      const char *pointer;         // longer key, stored in the arena
+    } key;
+    uint32_t length;
+    NgramValue value;
+
+    const char *getKey() const {
+      return length <= INLINE_KEY_SIZE ? key.bytes : key.pointer;
+    }
+  };
+
+  ngram_vector<Item> items;
+
+  unsigned char *controlBlock; // allocation holding controls
+  unsigned char *controls;     // control byte per slot, 16 bytes aligned
+  uint32_t *slots;             // item index per slot
+  size_t capacity;             // number of slots, power of 2
+  size_t groupMask;            // number of groups - 1
+
+  ngram_vector<char *> arenaBlocks;
+  char *arenaNext;  // free space in the current arena block
+  size_t arenaLeft; // bytes left in the current arena block
+
+  /**
+   * put an item into the first empty slot of its probe sequence
+   */
+  void insertSlot(uint64_t hash, uint32_t index);
+
+  /**
+   * reallocate the index with given number of slots, and re-insert all items
+   */
+  void rehash(size_t newCapacity);
+
+  /**
+   * copy a key into the arena, null terminated
+   */
+  const char *storeKey(const char *key, size_t length);
+};
+
+#endif
@@ -0,0 +1,90 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _HYPER_LOG_LOG_H_
+#define _HYPER_LOG_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * HyperLogLog, an estimate of the number of distinct keys of a stream in a
+ * few kilobytes.
+ *
+ * The first precision bits of a key hash pick one of 2^precision registers,
+ * which keeps the highest rank, the position of the first 1 bit, of the
+ * other bits seen. The estimate is the harmonic mean of 2^rank over the
+ * registers, counted by linear counting of the empty registers for small
+ * sets. Its standard error is 1.04 / sqrt( 2^precision ).
+ *
+ * The registers are dense, a byte each. Sketches of parts of a stream are
+ * merged by their register maximums, 16 at a time with SSE2 when available.
+ */
+class HyperLogLog {
+public:
+  enum { MIN_PRECISION = 4, MAX_PRECISION = 18 };
+
+  /**
+   * @param	precision - bits of the hash picking a register, clamped to
+   *		MIN_PRECISION..MAX_PRECISION
+   */
+  explicit HyperLogLog(int precision);
+
+  ~HyperLogLog();
+
+  /**
+   * add the key of given hash, a hash with well mixed bits
+   */
+  void add(uint64_t hash);
+
+  /**
+   * add the keys of another sketch of the same precision
+   */
+  void merge(const HyperLogLog &other);
+
+  /**
+   * get the estimated number of distinct keys added
+   */
+  int64_t estimate() const;
+
+  /**
+   * get the relative standard error of estimate()
+   */
+  double getStandardError() const;
+
+  int getPrecision() const { return precision; }
+
+  size_t getMemoryUsage() const { return registerCount; }
+
+private:
+  uint8_t *registers;   // highest rank seen by each register
+  size_t registerCount; // 2^precision
+  int precision;        // bits of the hash picking a register
+
+  HyperLogLog(const HyperLogLog &);
+  void operator=(const HyperLogLog &);
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _INPUT_READER_H_
+#define _INPUT_READER_H_
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * Reads an input file as blocks of contiguous bytes.
+ *
+ * Regular files are memory mapped and returned as a single block, with the
+ * kernel advised of sequential access. stdin, pipes and other files that can
+ * not be mapped are read in large blocks.
+ */
+class InputReader {
+public:
+  InputReader();
+
+  ~InputReader() { close(); }
+
+  /**
+   * open the input
+   * @param	fileName - file to read, empty for stdin
+   * @return	false if the file can not be opened
+   */
+  bool open(const char *fileName);
+
+  /**
+   * get the next block of input, valid until the next call
+   * @param	begin - set to the first byte of the block
+   * @param	end - set past the last byte of the block
+   * @return	false at the end of input
+   */
+  bool read(const char *&begin, const char *&end);
+
+  /**
+   * true if the whole input is memory mapped
+   */
+  bool isMapped() const { return map != NULL; }
+
+  void close();
+
+private:
+  enum { BLOCK_SIZE = 4 << 20 }; // bytes per read when not mapped
+
+  FILE *fp;         // input, when not mapped
+  char *map;        // mapped input
+  size_t mapLength; // bytes mapped
+  bool mapRead;     // whether the mapped block has been returned
+  char *buffer;     // block buffer, when not mapped
+
+  InputReader(const InputReader &);
+  void operator=(const InputReader &);
+};
+
+#endif
@@ -0,0 +1,128 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _NGRAM_ARENA_H_
+#define _NGRAM_ARENA_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <ngram/ngram_vector.h>
+
+/**
+ * Arena of objects addressed by a 32 bits index, up to 2^32 of them.
+ *
+ * Objects are constructed in place in large blocks, so adding one costs no
+ * malloc, and the whole arena is released a block at a time. Blocks never
+ * move, so pointers to objects stay valid until clear().
+ */
+template <class Object> class ngram_arena {
+public:
+  ngram_arena() : objectCount(0) {}
+
+  ~ngram_arena() { clear(); }
+
+  /**
+   * construct an object at the end of the arena
+   * @param	args - arguments of the object constructor
+   * @return	index of the object
+   */
+  template <class... Args> uint32_t add(Args &&... args) {
+    if (objectCount > UINT32_MAX) {
+      fprintf(stderr, "ngram_arena:add - more than 2^32 objects\n");
+      abort();
+    }
+    if ((objectCount >> BLOCK_BITS) == blocks.count()) {
+      blocks.add((Object *)malloc(BLOCK_SIZE * sizeof(Object)));
+    }
+    new (&(*this)[(uint32_t)objectCount]) Object(std::forward<Args>(args)...);
+    return (uint32_t)objectCount++;
+  }
+
+  Object &operator[](uint32_t index) const {
+    return blocks[index >> BLOCK_BITS][index & BLOCK_MASK];
+  }
+
+  /**
+   * allocate the blocks for given number of objects at once
+   */
+  void reserve(size_t count) {
+    size_t blockCount = (count + BLOCK_MASK) >> BLOCK_BITS;
+    if (blockCount > blocks.capacity()) {
+      blocks.reserve(blockCount);
+    }
+    while (blocks.count() < blockCount) {
+      blocks.add((Object *)malloc(BLOCK_SIZE * sizeof(Object)));
+    }
+  }
+
+  /**
+   * get number of objects in the arena
+   */
+  size_t count() const { return objectCount; }
+
+  /**
+   * get number of bytes allocated for the blocks
+   */
+  size_t getMemoryUsage() const {
+    return blocks.count() * BLOCK_SIZE * sizeof(Object);
+  }
+
+  /**
+   * destroy all objects and release the blocks
+   */
+  void clear() {
+    if (!std::is_trivially_destructible<Object>::value) {
+      for (size_t i = 0; i < objectCount; i++) {
+        (*this)[(uint32_t)i].~Object();
+      }
+    }
+    for (size_t i = 0; i < blocks.count(); i++) {
+      free(blocks[i]);
+    }
+    blocks.clear();
+    objectCount = 0;
+  }
+
+private:
+  enum {
+    BLOCK_BITS = 14, // objects per block is 2 ^ BLOCK_BITS
+    BLOCK_SIZE = 1 << BLOCK_BITS,
+    BLOCK_MASK = BLOCK_SIZE - 1
+  };
+
+  ngram_vector<Object *> blocks;
+  size_t objectCount;
+
+  ngram_arena(const ngram_arena &);
+  void operator=(const ngram_arena &);
+};
+
+#endif
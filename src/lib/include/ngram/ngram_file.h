@@ -0,0 +1,292 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _NGRAM_FILE_H_
+#define _NGRAM_FILE_H_
+
+#include <stdint.h>
+
+#include <ngram/ngram_vector.h>
+#include <ngram/output_writer.h>
+#include <ngram/utf8_string.h>
+
+/**
+ * Binary ngram count file, the interchange format between counting and
+ * scoring jobs. It is laid out so that it can be written in one pass and
+ * used in place once memory mapped:
+ *
+ *   vocabulary	the words, then the word index
+ *   N blocks	for each N: the keys, then the key index unless all keys
+ *		are keyWidth bytes long, then the frequencies bit packed
+ *		into uint64 words, countBits bits each
+ *   orders	NgramFileOrder for each N
+ *   header	NgramFileHeader, the last bytes of the file
+ *
+ * An index holds the file offsets of the words or keys, plus the offset
+ * past the last one, as uint64. Every block starts at a multiple of 8 bytes.
+ * Integers are in the byte order of the writer, which the reader checks.
+ *
+ * Keys of each N are sorted by memcmp, shorter first on ties. A word ngram
+ * key is the N word ids as big endian uint32, where the id of a word is its
+ * index in the sorted vocabulary, so keys sort as the words do. Character
+ * ngram keys are the characters, byte ngram keys the bytes.
+ */
+struct NgramFileOrder {
+  uint64_t total;          // ngrams of this N, Ngrams::total( n )
+  uint64_t unique;         // unique ngrams of this N, Ngrams::count( n )
+  uint64_t keyCount;       // keys stored, fewer than unique with a min count
+  uint64_t keyOffset;      // file offset of the keys
+  uint64_t keyWidth;       // bytes per key, 0 if they have a key index
+  uint64_t keyIndexOffset; // file offset of the key index, 0 for none
+  uint64_t countOffset;    // file offset of the packed frequencies
+  uint32_t countBits;      // bits per frequency
+  uint32_t reserved;
+};
+
+struct NgramFileHeader {
+  char magic[8];            // NGRAM_FILE_MAGIC
+  uint32_t byteOrder;       // NGRAM_FILE_BYTE_ORDER as written
+  uint32_t version;         // NGRAM_FILE_VERSION
+  uint32_t type;            // Config::WORD_NGRAM, CHAR_NGRAM or BYTE_NGRAM
+  uint32_t maxN;            // orders stored, 1..maxN
+  int64_t prunedCount;      // Ngrams::getPrunedCount()
+  uint64_t wordCount;       // words in the vocabulary, 0 if none
+  uint64_t wordIndexOffset; // file offset of the word index
+  uint64_t orderOffset;     // file offset of the NgramFileOrder array
+};
+
+#define NGRAM_FILE_MAGIC "NGRAMBIN"
+#define NGRAM_FILE_BYTE_ORDER 0x01020304
+#define NGRAM_FILE_VERSION 1
+
+/**
+ * Writes a binary ngram count file in one pass: the words of the
+ * vocabulary first, if any, then the ngrams of each N in key order.
+ */
+class NgramFileWriter {
+public:
+  NgramFileWriter();
+
+  ~NgramFileWriter() { close(); }
+
+  /**
+   * create the file
+   * @param	type - Config::WORD_NGRAM, CHAR_NGRAM or BYTE_NGRAM
+   * @param	maxN - largest N to be written
+   * @return	false if the file can not be created
+   */
+  bool open(const char *fileName, int type, int maxN);
+
+  /**
+   * add the next word of the vocabulary, in strcmp order
+   */
+  void addWord(const char *word, size_t length);
+
+  /**
+   * start writing the ngrams of given N, after those of N - 1
+   */
+  void beginOrder(int n);
+
+  /**
+   * add the next ngram of the current N, in key order
+   */
+  void addNgram(const char *key, size_t length, uint64_t frequency);
+
+  void setPrunedCount(int64_t prunedCount) {
+    header.prunedCount = prunedCount;
+  }
+
+  /**
+   * write the ngrams of the N begun last
+   * @param	total - ngrams of this N, duplications counted
+   * @param	unique - unique ngrams of this N
+   */
+  void endOrder(uint64_t total, uint64_t unique);
+
+  /**
+   * write the header and close the file
+   * @return	false if writing failed
+   */
+  bool close();
+
+  /**
+   * encode a word ngram key from word ids
+   * @param	key - gets n * 4 bytes
+   */
+  static void encodeWordKey(const uint32_t *ids, int n, char *key);
+
+private:
+  OutputWriter out;
+  uint64_t offset;                      // bytes written so far
+  NgramFileHeader header;
+  NgramFileOrder *orders;               // one per N
+  int order;                            // N being written, 0 for none
+  ngram_vector<uint64_t> offsets;       // index of the words or keys
+  ngram_vector<uint64_t> frequencies;   // frequencies of the current N
+  bool isOpen;
+
+  void write(const void *data, size_t length) {
+    out.write((const char *)data, length);
+    offset += length;
+  }
+
+  /**
+   * write zeros up to a multiple of 8 bytes
+   */
+  void align();
+
+  /**
+   * write the index of the words after the last word
+   */
+  void endVocabulary();
+
+  NgramFileWriter(const NgramFileWriter &);
+  void operator=(const NgramFileWriter &);
+};
+
+/**
+ * Reads a binary ngram count file, memory mapped, so ngrams are looked up
+ * by binary search over the keys in place without parsing anything.
+ */
+class NgramFileReader {
+public:
+  NgramFileReader();
+
+  ~NgramFileReader() { close(); }
+
+  /**
+   * open the file
+   * @return	false if it can not be read or is not a ngram count file
+   */
+  bool open(const char *fileName);
+
+  void close();
+
+  int getType() const { return (int)header->type; }
+
+  int getN() const { return (int)header->maxN; }
+
+  int64_t getPrunedCount() const { return header->prunedCount; }
+
+  /**
+   * total ngrams of given N, duplications counted
+   */
+  uint64_t total(int n) const { return isOrder(n) ? orders[n - 1].total : 0; }
+
+  /**
+   * unique ngrams of given N seen while counting
+   */
+  uint64_t count(int n) const { return isOrder(n) ? orders[n - 1].unique : 0; }
+
+  /**
+   * number of ngrams of given N stored in the file
+   */
+  size_t getKeyCount(int n) const {
+    return isOrder(n) ? (size_t)orders[n - 1].keyCount : 0;
+  }
+
+  /**
+   * get the key of the index-th ngram of given N, not null terminated
+   */
+  const char *getKey(int n, size_t index, size_t &length) const;
+
+  /**
+   * get the frequency of the index-th ngram of given N
+   */
+  uint64_t getFrequency(int n, size_t index) const;
+
+  /**
+   * get the frequency of the ngram of given N and key, 0 if not stored
+   */
+  uint64_t getFrequency(int n, const char *key, size_t length) const;
+
+  /**
+   * get the frequency of a word ngram, 0 if not stored
+   * @param	words - the n words, null terminated
+   */
+  uint64_t getFrequency(const char *const *words, int n) const;
+
+  /**
+   * find the index of the ngram of given N and key
+   * @return	false if not stored
+   */
+  bool find(int n, const char *key, size_t length, size_t &index) const;
+
+  size_t getWordCount() const { return (size_t)header->wordCount; }
+
+  /**
+   * get the word of given id, not null terminated
+   * @return	NULL if the id is not in the vocabulary, as in a corrupt key
+   */
+  const char *getWord(uint32_t id, size_t &length) const;
+
+  /**
+   * find the id of a word
+   * @return	false if not in the vocabulary
+   */
+  bool findWord(const char *word, size_t length, uint32_t &id) const;
+
+  /**
+   * convert the index-th ngram of given N into readable text, as in the text
+   * output
+   * @param	ngram - the ngram is appended to it
+   * @return	false if a word id of the key is not in the vocabulary
+   */
+  bool decodeNgram(int n, size_t index, utf8_string &ngram) const;
+
+  /**
+   * compare keys in the order of the file, by memcmp, shorter first on ties
+   */
+  static int compareKeys(const char *key1, size_t length1, const char *key2,
+                         size_t length2);
+
+private:
+  const char *data;              // the mapped file
+  size_t length;                 // bytes mapped
+  bool mapped;                   // whether data is mapped, or malloc'ed
+  const NgramFileHeader *header;
+  const NgramFileOrder *orders;
+  const uint64_t *wordIndex;     // file offsets of the words
+
+  bool isOrder(int n) const { return n > 0 && n <= (int)header->maxN; }
+
+  /**
+   * check that the blocks described by the header lie within the file, and
+   * that word ngram keys are N word ids wide. The word ids themselves are
+   * checked when they are looked up.
+   */
+  bool validate() const;
+
+  /**
+   * check that an index of count items at offset lies before end, and that
+   * its offsets ascend up to the index
+   */
+  bool isIndex(uint64_t offset, uint64_t count, uint64_t end) const;
+
+  NgramFileReader(const NgramFileReader &);
+  void operator=(const NgramFileReader &);
+};
+
+#endif
@@ -0,0 +1,81 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _NGRAM_MERGER_H_
+#define _NGRAM_MERGER_H_
+
+#include <ngram/config.h>
+#include <ngram/ngram_file.h>
+
+class Ngrams;
+
+/**
+ * Merges ngram count files of one kind of ngrams, adding up the frequencies
+ * of each ngram and the totals of each N.
+ *
+ * Binary ngram count files have sorted keys, so when all the inputs and the
+ * output are binary, they are merged in one pass with a heap of the files,
+ * in memory for their vocabularies only. Otherwise all the counts are loaded
+ * into a table and output from there, the way counted ngrams are.
+ */
+class NgramMerger {
+public:
+  explicit NgramMerger(const NgramOptions &newOptions)
+      : options(newOptions) {}
+
+  /**
+   * merge the files into outFileName, as options.format tells
+   * @param	outFileName - file to write, empty for stdout
+   * @return	false if an input can not be read, or they do not all hold
+   *		the same kind of ngrams
+   */
+  bool merge(const char *const *inFileNames, int fileCount,
+             const char *outFileName);
+
+  /**
+   * create an empty counter of given kind to load counts into
+   * @param	type - Config::WORD_NGRAM, CHAR_NGRAM or BYTE_NGRAM
+   */
+  static Ngrams *createNgrams(int type, int n, const char *outFileName,
+                              const NgramOptions &options);
+
+private:
+  NgramOptions options;
+
+  /**
+   * merge binary ngram count files with a heap, streaming the ngrams of
+   * each N in key order
+   */
+  bool mergeSorted(NgramFileReader *readers, int fileCount,
+                   const char *outFileName);
+
+  /**
+   * find the kind of ngrams and the largest N of a count file
+   * @return	false if it can not be read
+   */
+  static bool probe(const char *fileName, int &type, int &maxN);
+};
+
+#endif
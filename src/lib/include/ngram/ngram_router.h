@@ -0,0 +1,133 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _NGRAM_ROUTER_H_
+#define _NGRAM_ROUTER_H_
+
+#include <ngram/partitioned_ngram_table.h>
+#include <ngram/spsc_queue.h>
+
+/**
+ * Routes ngrams from tokenizer threads ( producers ) to the threads owning
+ * the partitions of a PartitionedNgramTable, so each sub table is only ever
+ * touched by its owner and no merge is needed.
+ *
+ * Each producer appends the ngrams of a partition to a batch, full batches
+ * are passed through one spsc_queue per producer and partition.
+ */
+class NgramRouter {
+public:
+  /**
+   * @param	producerCount - number of producer threads
+   * @param	table - table to fill
+   * @param	ngramN - largest N of the ngrams
+   */
+  NgramRouter(int producerCount, PartitionedNgramTable *table, int ngramN);
+
+  ~NgramRouter();
+
+  /**
+   * get a cursor before the first byte of any key, producers advance it over
+   * their ngram keys one token at a time
+   */
+  NgramTable::Cursor getCursor() { return table->getCursor(); }
+
+  NgramTable::Cursor advance(NgramTable::Cursor cursor, const char *key,
+                             size_t length) {
+    return table->advance(cursor, key, length);
+  }
+
+  /**
+   * send a ngram to the owner of its partition, called by the producer
+   * @param	producer - index of the calling producer
+   * @param	cursor - cursor advanced over the whole key, it picks the
+   *		partition and is passed on so the owner does not hash the key again
+   * @param	length - length of the ngram key
+   * @param	n - N of the ngram
+   */
+  void add(int producer, NgramTable::Cursor cursor, const char *ngram,
+           size_t length, int n);
+
+  /**
+   * send the partially filled batches of a producer, which is done
+   */
+  void finish(int producer);
+
+  /**
+   * count the ngrams of a partition into its sub table until all producers
+   * are done, called by the owner of the partition
+   */
+  void aggregate(int partition);
+
+  /**
+   * get number of unique ngrams of given N added to a partition
+   */
+  int64_t count(int partition, int n) const {
+    return uniques[partition * ngramN + n - 1];
+  }
+
+private:
+  enum {
+    BATCH_SIZE = 64 * 1024, // bytes of ngrams per batch
+    QUEUE_SIZE = 64         // batches queued per producer and partition
+  };
+
+  /**
+   * header of a ngram record in a batch, followed by the key
+   */
+  struct Record {
+    NgramTable::Cursor cursor; // cursor advanced over the key
+    uint32_t length;           // length of the key
+    uint32_t n;                // N of the ngram
+  };
+
+  /**
+   * batch of ngram records, followed by the records in memory
+   */
+  struct Batch {
+    size_t length;   // bytes of records
+    size_t capacity; // bytes allocated for records
+    char *getRecords() { return (char *)(this + 1); }
+  };
+
+  int producerCount;
+  int partitionCount;
+  int ngramN;
+  PartitionedNgramTable *table;
+  spsc_queue<Batch *> **queues; // queue of each producer and partition
+  Batch **batches;              // batch filled by each producer and partition
+  int64_t *uniques;             // unique ngrams for each partition and N
+  std::atomic<int> finishedProducers;
+
+  /**
+   * pass the batch of a producer for a partition on to the owner
+   */
+  void send(int producer, int partition);
+
+  NgramRouter(const NgramRouter &);
+  void operator=(const NgramRouter &);
+};
+
+#endif
@@ -0,0 +1,259 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _NGRAM_RUN_H_
+#define _NGRAM_RUN_H_
+
+#include <ngram/ngram_vector.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * A sorted run of ngrams spilled to a temporary file, written once in order
+ * of NgramRun::compare and then read back, for a k-way merge.
+ *
+ * Each ngram is stored front coded and varint packed: the number of key
+ * bytes shared with the previous key, the number of the other bytes, those
+ * bytes, N and the frequency. The file is deleted when the run is.
+ */
+class NgramRun {
+public:
+  NgramRun();
+
+  ~NgramRun();
+
+  /**
+   * create the temporary file, in $TMPDIR or /tmp
+   * @return	false if it can not be created
+   */
+  bool create();
+
+  /**
+   * add the next ngram, after all the smaller ones
+   */
+  void add(const char *key, size_t length, int n, uint64_t frequency);
+
+  /**
+   * end writing, and start reading before the first ngram, again if read
+   * before
+   * @return	false if writing the run failed
+   */
+  bool rewind();
+
+  /**
+   * read the next ngram
+   * @return	false at the end of the run
+   */
+  bool next();
+
+  /**
+   * get key of the ngram read last, not null terminated
+   */
+  const char *getKey() const { return key; }
+
+  size_t getKeyLength() const { return keyLength; }
+
+  int getN() const { return n; }
+
+  uint64_t getFrequency() const { return frequency; }
+
+  /**
+   * get bytes written to the run
+   */
+  uint64_t getSize() const { return size; }
+
+  /**
+   * order of ngrams in a run: by key bytes, shorter first on ties, then by N
+   */
+  static int compare(const char *key1, size_t length1, int n1,
+                     const char *key2, size_t length2, int n2);
+
+private:
+  enum { BUFFER_SIZE = 1 << 20 }; // bytes read or written at a time
+
+  FILE *fp;
+  char *buffer;        // bytes to write, or read
+  size_t bufferLength; // bytes in buffer
+  size_t bufferPos;    // bytes of buffer read
+  bool failed;         // whether writing failed
+  bool reading;        // whether the run is written and being read
+
+  char *key;        // key of the last ngram
+  size_t keyLength;
+  size_t keySize;   // bytes allocated for key
+  int n;
+  uint64_t frequency;
+  uint64_t size;
+
+  void write(const char *data, size_t length);
+
+  void writeVarint(uint64_t value);
+
+  bool read(char *data, size_t length);
+
+  bool readVarint(uint64_t &value);
+
+  void flush();
+
+  NgramRun(const NgramRun &);
+  void operator=(const NgramRun &);
+};
+
+/**
+ * A k-way merge of sorted runs, reading their ngrams in order of
+ * NgramRun::compare through a min heap. An ngram found in several runs is
+ * read once from each.
+ */
+class NgramRunMerger {
+public:
+  NgramRunMerger() : heap(NULL), heapSize(0), top(NULL) {}
+
+  /**
+   * the runs added are deleted with the merger
+   */
+  ~NgramRunMerger();
+
+  /**
+   * add a written run to merge, the merger takes it over
+   */
+  void add(NgramRun *run) { runs.add(run); }
+
+  size_t count() const { return runs.count(); }
+
+  /**
+   * end writing the runs, and start reading before their first ngram
+   * @return	false if writing a run failed
+   */
+  bool rewind();
+
+  /**
+   * read the next ngram
+   * @return	false at the end of all runs
+   */
+  bool next();
+
+  /**
+   * get key of the ngram read last, not null terminated
+   */
+  const char *getKey() const { return top->getKey(); }
+
+  size_t getKeyLength() const { return top->getKeyLength(); }
+
+  int getN() const { return top->getN(); }
+
+  uint64_t getFrequency() const { return top->getFrequency(); }
+
+private:
+  ngram_vector<NgramRun *> runs;
+  NgramRun **heap; // runs left to read, by their current ngram
+  size_t heapSize;
+  NgramRun *top;   // run of the ngram read last, out of the heap
+
+  NgramRunMerger(const NgramRunMerger &);
+  void operator=(const NgramRunMerger &);
+};
+
+/**
+ * Sorts ngrams in order of NgramRun::compare within a memory budget. They are
+ * buffered and sorted in memory, and once the buffer grows past the budget
+ * they are spilled to a run, all runs being merged when read back. The buffer
+ * holds at least MIN_RUN_SIZE bytes, so that the runs stay few.
+ */
+class NgramRunSorter {
+public:
+  /**
+   * @param	memoryLimit - bytes of the buffer, 0 for sorting in memory only
+   */
+  explicit NgramRunSorter(size_t memoryLimit);
+
+  ~NgramRunSorter();
+
+  /**
+   * add a ngram, in any order
+   */
+  void add(const char *key, size_t length, int n, uint64_t frequency);
+
+  /**
+   * end adding, and start reading before the first ngram
+   * @return	false if writing a run failed
+   */
+  bool rewind();
+
+  /**
+   * read the next ngram
+   * @return	false after the last one
+   */
+  bool next();
+
+  /**
+   * get key of the ngram read last, not null terminated
+   */
+  const char *getKey() const;
+
+  size_t getKeyLength() const;
+
+  int getN() const;
+
+  uint64_t getFrequency() const;
+
+private:
+  enum {
+    MIN_KEYS_SIZE = 1 << 16, // bytes first allocated for keys
+    MIN_RUN_SIZE = 1 << 22   // bytes buffered before a spill, at least
+  };
+
+  struct Item {
+    size_t keyOffset; // offset of the key in keys
+    uint32_t keyLength;
+    uint32_t n;
+    uint64_t frequency;
+  };
+
+  size_t memoryLimit;
+  char *keys;               // keys of the buffered ngrams, back to back
+  size_t keysLength;        // bytes used in keys
+  size_t keysSize;          // bytes allocated for keys
+  ngram_vector<Item> items; // the buffered ngrams
+  size_t index;             // item read last, plus one
+  NgramRunMerger merger;    // the runs spilled, if any
+
+  /**
+   * sort the buffered ngrams
+   */
+  void sort();
+
+  /**
+   * write the buffered ngrams to a new run and empty the buffer
+   * @return	false if the run file can not be created, sorting goes on in
+   *		memory then
+   */
+  bool spill();
+
+  NgramRunSorter(const NgramRunSorter &);
+  void operator=(const NgramRunSorter &);
+};
+
+#endif
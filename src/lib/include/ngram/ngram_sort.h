@@ -0,0 +1,108 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _NGRAM_SORT_H_
+#define _NGRAM_SORT_H_
+
+#include <ngram/ngram_vector.h>
+#include <ngram/ngrams_base.h>
+
+#include <stdint.h>
+
+/**
+ * Sorts ngram tokens for output in the order of INgrams::FrequencyOrder,
+ * more frequent ngrams first, then ngrams of the same frequency by bytes.
+ *
+ * The frequency and the first 8 bytes of each ngram are copied into a sort
+ * key next to the token pointer, so most comparisons do not follow the
+ * pointers. With one thread the keys are sorted with std::sort. With more
+ * threads they are sorted by frequency with a parallel LSD radix sort, then
+ * each thread sorts the runs of equal frequency in its chunk of the keys,
+ * and the parts of runs cut by chunk boundaries are merged pairwise in
+ * parallel. The parallel sort takes a buffer as large as the keys.
+ */
+class NgramSort {
+public:
+  /**
+   * sort ngram tokens by frequency, then by ngram
+   * @param	threads - threads sorting, at most one per MIN_THREAD_KEYS
+   */
+  static void sortByFrequency(ngram_vector<INgrams::NgramToken *> &ngramVector,
+                              int threads = 1);
+
+private:
+  enum {
+    RADIX_BITS = 8,           // frequency bits sorted per radix pass
+    RADIX = 1 << RADIX_BITS,  // buckets of a radix pass
+    MIN_THREAD_KEYS = 1 << 16 // fewest keys worth another thread
+  };
+
+  struct Key {
+    int64_t frequency;
+    uint64_t prefix; // first 8 bytes of the ngram up to NUL, big endian
+    INgrams::NgramToken *token;
+  };
+
+  /**
+   * a part of the merge of two sorted ranges of keys, written to the buffer
+   */
+  struct MergeTask {
+    size_t left, leftEnd;   // part of the first range
+    size_t right, rightEnd; // part of the second range
+    size_t out;             // where the part goes in the buffer
+  };
+
+  /**
+   * the first bytes of a ngram as a number ordered like strcmp orders them
+   */
+  static uint64_t getPrefix(const char *ngram);
+
+  /**
+   * order of keys of the same frequency
+   */
+  static bool ngramLess(const Key &a, const Key &b);
+
+  /**
+   * sort the keys by descending frequency with a stable LSD radix sort
+   * @param	keys - keys to sort, gets the sorted keys
+   * @param	buffer - as many keys as keys, for the radix passes
+   */
+  static void radixSort(Key *&keys, Key *&buffer, size_t count,
+                        int64_t minFrequency, int64_t maxFrequency,
+                        int threads);
+
+  /**
+   * sort the keys of each frequency of keys sorted by frequency
+   */
+  static void sortRuns(Key *keys, Key *buffer, size_t count, int threads);
+
+  /**
+   * call function( t ) for t from 0 to threads - 1, each in a thread
+   */
+  template <class Function>
+  static void runThreads(int threads, Function function);
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _NGRAM_TABLE_H_
+#define _NGRAM_TABLE_H_
+
+#include <stdint.h>
+
+#include <ngram/ngrams_base.h>
+
+/**
+ * Interface of the table counting ngrams, which maps a ngram key to its
+ * NgramValue. Keys are byte strings given with their length.
+ *
+ * A key can be built incrementally with a cursor: getCursor() gives a
+ * cursor before the first byte of any key, advance() moves it over more
+ * bytes, and add() looks up the key ending at the cursor. Ngrams uses this to
+ * extend the ngrams of the token queue by one token at a time.
+ *
+ * Items are numbered 0..count()-1 in insertion order.
+ */
+class NgramTable {
+public:
+  typedef INgrams::NgramValue NgramValue;
+
+  /**
+   * opaque position of a partially walked key, meaning depends on the table
+   */
+  typedef uint64_t Cursor;
+
+  virtual ~NgramTable() {}
+
+  /**
+   * get a cursor positioned before the first byte of any key
+   */
+  virtual Cursor getCursor() = 0;
+
+  /**
+   * advance a cursor over the given bytes of a key
+   */
+  virtual Cursor advance(Cursor cursor, const char *key, size_t length) = 0;
+
+  /**
+   * Get value of the key ending at the cursor, the key is added with value
+   * NgramValue( n, 0 ) if not in the table yet.
+   *
+   * @param	cursor - cursor advanced over the whole key
+   * @param	key - the whole key
+   * @param	length - length of the key
+   * @param	n - N of the ngram
+   * @param	added - set to true if the key was added
+   * @return	value of the key
+   */
+  virtual NgramValue *add(Cursor cursor, const char *key, size_t length,
+                          int n, bool &added) = 0;
+
+  /**
+   * same as add( cursor, key, length, n, added ) for a key not walked yet
+   */
+  NgramValue *add(const char *key, size_t length, int n, bool &added) {
+    return add(advance(getCursor(), key, length), key, length, n, added);
+  }
+
+  /**
+   * get total number of keys in the table
+   */
+  virtual size_t count() const = 0;
+
+  /**
+   * get key of the item at given index. The key is not null terminated, and
+   * is only valid until the next key is added.
+   *
+   * @param	index - item index, 0..count()-1
+   * @param	length - set to length of the key
+   */
+  virtual const char *getKey(size_t index, size_t &length) = 0;
+
+  /**
+   * get value of the item at given index
+   */
+  virtual NgramValue &getValue(size_t index) = 0;
+
+  /**
+   * get approximate number of bytes allocated by the table
+   */
+  virtual size_t getMemoryUsage() const = 0;
+
+  /**
+   * allocate room for given number of keys at once, so the table does not
+   * grow and copy itself while they are added
+   */
+  virtual void reserve(size_t keyCount) = 0;
+
+  /**
+   * create a table of given type
+   * @param	tableType - Config::TST_TABLE or Config::HASH_TABLE
+   * @param	partitions - number of partitions, a PartitionedNgramTable of
+   *		such tables is created if more than 1
+   */
+  static NgramTable *create(int tableType, int partitions = 1);
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _NGRAM_TEXT_READER_H_
+#define _NGRAM_TEXT_READER_H_
+
+#include <stdint.h>
+
+#include <ngram/input_reader.h>
+#include <ngram/utf8_string.h>
+
+/**
+ * Reads ngram counts back from the text output of WordNgrams, CharNgrams or
+ * ByteNgrams, as a stream of entries: the header of each N, then its ngram
+ * lines.
+ */
+class NgramTextReader {
+public:
+  enum {
+    ORDER,  // header of the ngrams of an N
+    NGRAM,  // ngram line
+    END     // end of input
+  };
+
+  NgramTextReader();
+
+  /**
+   * open the file
+   * @param	fileName - file to read, empty for stdin
+   * @return	false if the file can not be opened
+   */
+  bool open(const char *fileName);
+
+  /**
+   * read the next entry
+   * @return	ORDER, NGRAM or END
+   */
+  int next();
+
+  /**
+   * get the kind of ngrams, Config::WORD_NGRAM, CHAR_NGRAM or BYTE_NGRAM,
+   * known once an ORDER is read, -1 before
+   */
+  int getType() const { return type; }
+
+  /**
+   * N of the last ORDER
+   */
+  int getN() const { return n; }
+
+  /**
+   * ngrams of the N of the last ORDER, duplications counted
+   */
+  int64_t getTotal() const { return total; }
+
+  /**
+   * get the ngram of the last NGRAM line, not null terminated
+   */
+  const char *getNgram(size_t &length) const {
+    length = ngramLength;
+    return ngram;
+  }
+
+  int64_t getFrequency() const { return frequency; }
+
+  /**
+   * get by how much frequencies may be too low, 0 if not pruned
+   */
+  int64_t getPrunedCount() const { return prunedCount; }
+
+private:
+  InputReader reader;
+  const char *begin;  // unread bytes of the current block
+  const char *end;
+  utf8_string line;   // a line continued over blocks
+  bool isByte;        // whether the output is of byte ngrams
+  int type;
+  int n;
+  int64_t total;
+  const char *ngram;
+  size_t ngramLength;
+  int64_t frequency;
+  int64_t prunedCount;
+
+  /**
+   * read the next line, without the newline
+   * @return	false at the end of input
+   */
+  bool readLine(const char *&text, size_t &length);
+
+  NgramTextReader(const NgramTextReader &);
+  void operator=(const NgramTextReader &);
+};
+
+#endif
@@ -26,8 +26,14 @@ WebSite: http://www.cs.dal.ca/~zyu
 #ifndef VECTOR_H
 #define VECTOR_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 class ArrayIndexOutOfBoundsException {};
 
@@ -41,45 +47,51 @@ private:
   size_t currentSize; /* current number of items in the vector */
   size_t maxSize;     /* max number of items the vector can hold */
   Object *objects;    /* pointer to the actual memory holding objects */
+
   /**
-   * static callback function for sorting, the objects should be sorted in
-   * ascending order, from lowest value to highest value.
+   * objects that can be moved by copying their bytes, the storage of those
+   * grows with realloc instead of moving the objects one by one.
    */
-  static int compareObjectsAsc(const void *a, const void *b) {
-    Object *x = (Object *)a;
-    Object *y = (Object *)b;
-    return *x < *y ? -1 : *x == *y ? 0 : 1;
-    /*if( *x < *y ) return -1;
-    else if( *x == *y ) return 0;
-    else return 1;
-    */
+  static const bool RELOCATABLE = std::is_trivially_copyable<Object>::value;
+
+  /**
+   * change the storage to hold newMaxSize objects, the objects in the vector
+   * are moved over to the new storage.
+   *
+   * @param	newMaxSize - number of objects the storage can hold, not less
+   * than the current size.
+   */
+  void reallocate(size_t newMaxSize);
+
+  /**
+   * grow the storage for one more object, doubling the capacity
+   */
+  void grow() { reallocate(maxSize != 0 ? maxSize << 1 : 1); }
+
+  /**
+   * destroy the objects in range [start, end), the storage is kept
+   */
+  void destroy(size_t start, size_t end) {
+    if (!std::is_trivially_destructible<Object>::value) {
+      for (size_t i = start; i < end; i++) {
+        objects[i].~Object();
+      }
+    }
   }
-#if 0
-   /**
-    * static callback function for sorting, the objects should be sorted in descending order, from highest value to lowest value.
-    */
-   static int compareObjectsDesc( const void* a, const void* b ) 
-   {
-      Object * x = (Object*)a;
-      Object * y = (Object*)b;
-      return *x > *y ? -1 : *x == *y ? 0 : 1;
-      /*
-      if( *x > *y ) return -1;
-      else if( *x == *y ) return 0;
-      else return 1; */
-   }
-#endif
 
 public:
+  typedef Object value_type;
+  typedef Object *iterator;
+  typedef const Object *const_iterator;
+
   /**
    * vector constructor
    * @param newMaxSize - size of vector to be constructed. if not specified,
    * default to 0. number of newMaxSize objects will be created.
    */
-  explicit ngram_vector(unsigned newMaxSize = 0)
-      : currentSize(newMaxSize), maxSize(newMaxSize) {
-    assert(newMaxSize >= 0);
-    objects = maxSize > 0 ? new Object[maxSize] : 0;
+  explicit ngram_vector(size_t newMaxSize = 0)
+      : currentSize(0), maxSize(0), objects(0) {
+    resize(newMaxSize);
   }
 
   /**
@@ -90,7 +102,19 @@ public:
   /**
    * vector copy
    */
-  ngram_vector(const ngram_vector &v) : objects(0) { operator=(v); }
+  ngram_vector(const ngram_vector &v)
+      : currentSize(0), maxSize(0), objects(0) {
+    operator=(v);
+  }
+
+  /**
+   * vector move, the storage of v is taken over and v is left empty
+   */
+  ngram_vector(ngram_vector &&v)
+      : currentSize(v.currentSize), maxSize(v.maxSize), objects(v.objects) {
+    v.currentSize = v.maxSize = 0;
+    v.objects = 0;
+  }
 
   /**
    * returns the number of items in the vector
@@ -102,6 +126,19 @@ public:
    */
   size_t capacity() const { return maxSize; }
 
+  /**
+   * iterators over the elements, to use the vector with <algorithm>
+   */
+  iterator begin() { return objects; }
+  iterator end() { return objects + currentSize; }
+  const_iterator begin() const { return objects; }
+  const_iterator end() const { return objects + currentSize; }
+
+  /**
+   * the memory holding the elements
+   */
+  Object *data() const { return objects; }
+
   /**
    * Removes all elements from the vector
    */
@@ -116,11 +153,19 @@ public:
    *    Adds an object to the end of the vector
    */
   void add(const Object &val);
+  void add(Object &&val);
+
+  /**
+   * constructs an object from args at the end of the vector
+   *
+   * @return the object added
+   */
+  template <class... Args> Object &emplace_back(Args &&... args);
 
   /**
    * Removes the element at the specified index of the vector.
    */
-  void removeAt(unsigned index);
+  void removeAt(size_t index);
 
   /**
    * Removes a range of elements from the vector.
@@ -129,7 +174,7 @@ public:
    * remove.
    * @param count - The number of elements to remove.
    */
-  void removeRange(unsigned index, unsigned count);
+  void removeRange(size_t index, size_t count);
 
   /**
    * Removes the first occurrence of a specific object from the vector.
@@ -151,7 +196,8 @@ public:
    * The member function inserts an element with value val at the end of the
    * controlled sequence.
    */
-  void push_back(const Object &val);
+  void push_back(const Object &val) { add(val); }
+  void push_back(Object &&val) { add(std::move(val)); }
 
   /**
    * operator[] which get the index-th element in the vector
@@ -159,7 +205,7 @@ public:
    * @param index - element index
    * @return the index-th element
    */
-  Object &operator[](unsigned index) const {
+  Object &operator[](size_t index) const {
     /*if( index < 0 || index >= currentSize )
     {
        throw ArrayIndexOutOfBoundsException( );
@@ -175,7 +221,7 @@ public:
    * @param index - index of element to return.
    * @return object at the specified index
    */
-  Object &get(unsigned index) const { return this->operator[](index); }
+  Object &get(size_t index) const { return this->operator[](index); }
 
   /**
    * Replaces the element at the specified position
@@ -186,7 +232,7 @@ public:
    * @return the element previously at the specified position.
    *
    */
-  Object set(unsigned index, const Object &element);
+  Object set(size_t index, const Object &element);
 
   /**
    * Searches for the first occurence of the given argument, beginning the
@@ -198,7 +244,7 @@ public:
    *         returns -1 if the object is not found.
    *         (Returns -1 if index >= the current size of this Vector.)
    */
-  int indexOf(Object val);
+  ptrdiff_t indexOf(Object val);
 
   /**
    * Searches for the first occurence of the given argument, beginning the
@@ -213,7 +259,7 @@ public:
    *         returns -1 if the object is not found.
    *         (Returns -1 if index >= the current size of this Vector.)
    */
-  int indexOf(Object val, unsigned index);
+  ptrdiff_t indexOf(Object val, size_t index);
 
   /**
    * Returns the index of the last occurrence of the specified object in this
@@ -225,7 +271,7 @@ public:
    *         elem.equals(elementData[k]) is true; returns -1 if the object is
    * not found.
    */
-  int lastIndexOf(const Object &val);
+  ptrdiff_t lastIndexOf(const Object &val);
 
   /**
    * Searches backwards for the specified object,
@@ -239,7 +285,7 @@ public:
    *          such that elem.equals(elementData[k]) && (k <= index) is true;
    *          -1 if the object is not found. (Returns -1 if index is negative.)
    */
-  int lastIndexOf(const Object &val, unsigned index);
+  ptrdiff_t lastIndexOf(const Object &val, size_t index);
 
   /**
    * Fuction to compare two itemss
@@ -252,30 +298,28 @@ public:
   typedef int (*CompareFunction)(const void *itemAddr1, const void *itemAddr);
 
   /**
-   * This method uses uses the QuickSort algorithm.
-   * This is an O(n ^2) operation, where n is the number of elements to sort,
-   * with an average of theta(n log n).
-   * sortAsc will sort objects in ascending order
-   * sortDes will sort objects in descending order
+   * sort items in the vector in ascending order of operator<
    */
+  void sort() { std::sort(begin(), end()); }
 
-  /*enum { SORT_ASC, SORT_DESC };
-  void sort() { sort( SORT_ASC); }
-  void sort ( int sortOrder )
-  {
-     qsort( objects, currentSize, sizeof(Object), sortOrder == SORT_ASC ?
-  vector<Object>::compareObjectsAsc : vector<Object>::compareObjectsDesc );
-  }
-  void sortAsc() { sort( SORT_ASC ); }
-  void sortDesc() { sort( SORT_DESC ); }
+  /**
+   * sort items in the vector by given less than comparator, which is inlined
+   * into std::sort instead of being called through a function pointer.
+   *
+   * @param	less - returns true if its first argument goes before its second
    */
+  template <class Less> void sort(Less less) {
+    std::sort(begin(), end(), less);
+  }
 
   /**
-   * sort items in the vector by given compare function
-   * if compare function is not specefied, default to Vecotr::compareObjectsAsc
+   * sort items in the vector by given qsort style compare function
    */
-  void sort(CompareFunction compareFunction = compareObjectsAsc) {
-    qsort(objects, currentSize, sizeof(Object), compareFunction);
+  void sort(CompareFunction compareFunction) {
+    std::sort(begin(), end(), [compareFunction](const Object &a,
+                                                const Object &b) {
+      return compareFunction(&a, &b) < 0;
+    });
   }
 
   /**
@@ -289,13 +333,18 @@ public:
    * @param index - The zero-based starting index of the range to reverse.
    * @param count - The number of elements in the range to reverse.
    */
-  void reverse(unsigned index, unsigned count);
+  void reverse(size_t index, size_t count);
 
   /**
    * assign operator
    */
   const ngram_vector &operator=(const ngram_vector &v);
 
+  /**
+   * move assign operator, the storage of v is taken over and v is left empty
+   */
+  ngram_vector &operator=(ngram_vector &&v);
+
   /**
    * Resizes the vector to contain newSize elements
    * @param newSize - size of the resized vector.
@@ -305,152 +354,180 @@ public:
    * is expanded by inserting at the end as many elements as needed to reach the
    * size of newSize. The values are initialised by default object constructor.
    */
-  void resize(int newSize);
+  void resize(size_t newSize);
 
   /**
    * reserve the space of the internal array to the size of newSize.
    * If newSize less than current array size, vector array will not be changed.
    */
-  void reserve(unsigned newSize);
+  void reserve(size_t newSize);
 };
 
+template <class Object>
+void ngram_vector<Object>::reallocate(size_t newMaxSize) {
+  assert(newMaxSize >= currentSize);
+  Object *newObjects;
+  if (RELOCATABLE) {
+    newObjects =
+        (Object *)realloc((void *)objects, newMaxSize * sizeof(Object));
+  } else {
+    newObjects = (Object *)malloc(newMaxSize * sizeof(Object));
+  }
+  if (newObjects == NULL && newMaxSize > 0) {
+    fprintf(stderr, "ngram_vector:reallocate - failed to allocate %zu items\n",
+            newMaxSize);
+    abort();
+  }
+  if (!RELOCATABLE) {
+    for (size_t i = 0; i < currentSize; i++) {
+      new (newObjects + i) Object(std::move(objects[i]));
+      objects[i].~Object();
+    }
+    free(objects);
+  }
+  objects = newObjects;
+  maxSize = newMaxSize;
+}
+
 template <class Object>
 const ngram_vector<Object> &
 ngram_vector<Object>::operator=(const ngram_vector<Object> &v) {
   if (this != &v) {
-    if (maxSize > 0) {
-      delete[] objects;
+    clear();
+    reserve(v.count());
+    for (size_t k = 0; k < v.count(); k++) {
+      new (objects + k) Object(v.objects[k]);
     }
-    maxSize = v.capacity();
     currentSize = v.count();
-    if (maxSize) {
-      objects = new Object[maxSize];
-    }
-    for (unsigned k = 0; k < currentSize; k++) {
-      objects[k] = v.objects[k];
-    }
   }
   return *this;
 }
 
-template <class Object> void ngram_vector<Object>::resize(int newSize) {
-  Object *oldArray = objects;
+template <class Object>
+ngram_vector<Object> &
+ngram_vector<Object>::operator=(ngram_vector<Object> &&v) {
+  if (this != &v) {
+    clear();
+    std::swap(currentSize, v.currentSize);
+    std::swap(maxSize, v.maxSize);
+    std::swap(objects, v.objects);
+  }
+  return *this;
+}
 
+template <class Object> void ngram_vector<Object>::resize(size_t newSize) {
   if (newSize <= this->currentSize) {
     // resize vector will have less elements than current vector has. The extra
-    // elements beyond the resized vector will be removed (and objects are NOT
-    // destroyed) the capacity will remain unchanged
+    // elements beyond the resized vector are destroyed, the capacity will
+    // remain unchanged
+    destroy(newSize, currentSize);
     this->currentSize = newSize;
   } else {
     // resized vector will have more elements than current vector has
     if (newSize > this->capacity()) {
-      // increase the capacity to new size
-      this->objects = new Object[newSize];
-      // copy over the original elements, and destroy the old array
-      for (unsigned k = 0; k < this->currentSize; k++) {
-        this->objects[k] = oldArray[k];
-      }
-      if (this->maxSize > 0) {
-        delete[] oldArray;
-      }
-      this->maxSize = newSize;
+      reallocate(newSize);
     }
 
-    for (unsigned j = this->currentSize; j < newSize; j++) {
-      this->objects[j] = Object();
+    for (size_t j = this->currentSize; j < newSize; j++) {
+      new (objects + j) Object();
     }
 
     this->currentSize = newSize;
   }
 }
 
-template <class Object> void ngram_vector<Object>::reserve(unsigned newSize) {
-  Object *oldArray = objects;
-  if (newSize < currentSize) {
-    currentSize = newSize;
-  }
-  objects = new Object[newSize];
-  for (unsigned k = 0; k < currentSize; k++) {
-    objects[k] = oldArray[k];
-  }
-
-  if (maxSize > 0) {
-    delete[] oldArray;
+template <class Object> void ngram_vector<Object>::reserve(size_t newSize) {
+  if (newSize > maxSize) {
+    reallocate(newSize);
   }
-  maxSize = newSize;
 }
 
 template <class Object>
 void ngram_vector<Object>::insert(const Object &val, size_t pos) {
-  size_t originalMaxSize = maxSize;
-
   // if (pos < 0 || pos > currentSize)
   //   throw ArrayIndexOutOfBoundsException( );
   assert(pos >= 0 && pos <= currentSize);
 
+  if (pos == currentSize) {
+    add(val);
+    return;
+  }
+  // val may be an element of the vector, which moves below
+  Object copy(val);
   if (currentSize == maxSize) {
-    maxSize = maxSize != 0 ? maxSize << 1 : 1;
-    /*if ( maxSize < GROW_THRESHOLD )
-       maxSize *= 2;
-    else
-       maxSize += GROW_BLOCK_SIZE;
-    if ( maxSize <= 0 )
-       maxSize = 1;
-    */
-    Object *newObjects = new Object[maxSize];
-
-    for (unsigned i = 0; i < currentSize; i++)
-      newObjects[i] = objects[i];
-
-    if (originalMaxSize > 0) {
-      delete[] objects;
-    }
-
-    objects = newObjects;
+    grow();
+  }
+  new (objects + currentSize) Object(std::move(objects[currentSize - 1]));
+  for (size_t i = currentSize - 1; i > pos; i--) {
+    objects[i] = std::move(objects[i - 1]);
   }
-  for (size_t i = currentSize; i > pos; i--)
-    objects[i] = objects[i - 1];
-  objects[pos] = val;
+  objects[pos] = std::move(copy);
   ++currentSize;
 }
 
+template <class Object> void ngram_vector<Object>::clear() {
+  destroy(0, currentSize);
+  free(objects);
+  objects = 0;
+  currentSize = maxSize = 0;
+}
+
 template <class Object>
-inline void ngram_vector<Object>::push_back(const Object &val) {
-  this->insert(val, currentSize);
+inline void ngram_vector<Object>::add(const Object &val) {
+  if (currentSize == maxSize) {
+    // val may be an element of the vector, which moves when growing
+    Object copy(val);
+    grow();
+    new (objects + currentSize) Object(std::move(copy));
+  } else {
+    new (objects + currentSize) Object(val);
+  }
+  ++currentSize;
 }
 
-template <class Object> void ngram_vector<Object>::clear() {
-  if (maxSize > 0) {
-    delete[] objects;
+template <class Object> inline void ngram_vector<Object>::add(Object &&val) {
+  if (currentSize == maxSize) {
+    Object moved(std::move(val));
+    grow();
+    new (objects + currentSize) Object(std::move(moved));
+  } else {
+    new (objects + currentSize) Object(std::move(val));
   }
-  currentSize = maxSize = 0;
+  ++currentSize;
 }
 
 template <class Object>
-inline void ngram_vector<Object>::add(const Object &val) {
-  this->insert(val, currentSize);
+template <class... Args>
+inline Object &ngram_vector<Object>::emplace_back(Args &&... args) {
+  if (currentSize == maxSize) {
+    // args may refer to elements of the vector, which move when growing
+    Object constructed(std::forward<Args>(args)...);
+    grow();
+    new (objects + currentSize) Object(std::move(constructed));
+  } else {
+    new (objects + currentSize) Object(std::forward<Args>(args)...);
+  }
+  return objects[currentSize++];
 }
 
-template <class Object> void ngram_vector<Object>::removeAt(unsigned index) {
+template <class Object> void ngram_vector<Object>::removeAt(size_t index) {
   removeRange(index, 1);
 }
 
 template <class Object>
-void ngram_vector<Object>::removeRange(unsigned index, unsigned count) {
+void ngram_vector<Object>::removeRange(size_t index, size_t count) {
   /*if ( index < 0 || index + count > currentSize ) // index out of boundary
      throw ArrayIndexOutOfBoundsException( );
    */
   assert(index >= 0 && index + count <= currentSize);
 
-  for (unsigned i = index; i < currentSize - 1; i++) {
-    objects[i] = objects[i + count];
-  }
-
+  std::move(objects + index + count, objects + currentSize, objects + index);
+  destroy(currentSize - count, currentSize);
   currentSize -= count;
 }
 
 template <class Object> void ngram_vector<Object>::remove(const Object &val) {
-  for (unsigned i = 0; i < currentSize; i++) {
+  for (size_t i = 0; i < currentSize; i++) {
     if (objects[i] == val) {
       removeAt(i); // if find the first occurrence, remove it.
       break;
@@ -460,7 +537,7 @@ template <class Object> void ngram_vector<Object>::remove(const Object &val) {
 
 template <class Object> bool ngram_vector<Object>::contains(const Object &val) {
   bool ret = false;
-  for (unsigned i = 0; i < currentSize; i++) {
+  for (size_t i = 0; i < currentSize; i++) {
     if (objects[i] == val) {
       ret = true;
       break;
@@ -469,7 +546,7 @@ template <class Object> bool ngram_vector<Object>::contains(const Object &val) {
   return ret;
 }
 template <class Object>
-Object ngram_vector<Object>::set(unsigned index, const Object &element) {
+Object ngram_vector<Object>::set(size_t index, const Object &element) {
   /*if( index < 0 || index >= currentSize )
   {
      throw ArrayIndexOutOfBoundsException( );
@@ -481,21 +558,21 @@ Object ngram_vector<Object>::set(unsigned index, const Object &element) {
   return original;
 }
 
-template <class Object> int ngram_vector<Object>::indexOf(Object val) {
+template <class Object> ptrdiff_t ngram_vector<Object>::indexOf(Object val) {
   return indexOf(val, 0);
 }
 
 template <class Object>
-int ngram_vector<Object>::indexOf(Object val, unsigned index) {
-  int ret = -1;
+ptrdiff_t ngram_vector<Object>::indexOf(Object val, size_t index) {
+  ptrdiff_t ret = -1;
   /*if ( index < 0 || index >= currentSize )
   {
      throw ArrayIndexOutOfBoundsException( );
   }*/
   assert(index >= 0 && index < currentSize);
-  for (unsigned i = index; i < currentSize; i++) {
+  for (size_t i = index; i < currentSize; i++) {
     if (objects[i] == val) {
-      ret = (int)i;
+      ret = (ptrdiff_t)i;
       break;
     }
   }
@@ -503,22 +580,22 @@ int ngram_vector<Object>::indexOf(Object val, unsigned index) {
 }
 
 template <class Object>
-int ngram_vector<Object>::lastIndexOf(const Object &val) {
-  return currentSize > 0 ? lastIndexOf(val, (int)currentSize - 1) : -1;
+ptrdiff_t ngram_vector<Object>::lastIndexOf(const Object &val) {
+  return currentSize > 0 ? lastIndexOf(val, currentSize - 1) : -1;
 }
 
 template <class Object>
-int ngram_vector<Object>::lastIndexOf(const Object &val, unsigned index) {
-  int ret = -1;
+ptrdiff_t ngram_vector<Object>::lastIndexOf(const Object &val, size_t index) {
+  ptrdiff_t ret = -1;
   /*if ( index < 0 || index >= currentSize )
   {
      throw ArrayIndexOutOfBoundsException( );
   }
    */
   assert(index >= 0 && index < currentSize);
-  for (int i = index; i >= 0; i--) {
+  for (size_t i = index + 1; i-- > 0;) {
     if (objects[i] == val) {
-      ret = (int)i;
+      ret = (ptrdiff_t)i;
       break;
     }
   }
@@ -527,12 +604,12 @@ int ngram_vector<Object>::lastIndexOf(const Object &val, unsigned index) {
 
 template <class Object> void ngram_vector<Object>::reverse() {
   if (currentSize > 0) {
-    reverse(0, (unsigned)currentSize);
+    reverse(0, currentSize);
   }
 }
 
 template <class Object>
-void ngram_vector<Object>::reverse(unsigned index, unsigned count) {
+void ngram_vector<Object>::reverse(size_t index, size_t count) {
   /*if ( index < 0 || index >= currentSize || count <= 0 || count > currentSize
   )
   {
@@ -541,13 +618,10 @@ void ngram_vector<Object>::reverse(unsigned index, unsigned count) {
    */
   assert(index >= 0 && index < currentSize && count > 0 &&
          count <= currentSize);
-  unsigned midIndex = (index + count) / 2;
-  unsigned endIndex = index + count - 1;
+  size_t endIndex = index + count - 1;
 
-  for (unsigned i = 0; i < midIndex; i++) {
-    Object tmp = objects[i];
-    objects[i] = objects[endIndex - i];
-    objects[endIndex - i] = tmp;
+  for (size_t i = 0; i < count / 2; i++) {
+    std::swap(objects[index + i], objects[endIndex - i]);
   }
 }
 
@@ -26,12 +26,48 @@ WebSite: http://www.cs.dal.ca/~zyu
 #ifndef _Ngrams_h
 #define _Ngrams_h
 
+#include <ngram/byte_set.h>
 #include <ngram/config.h>
+#include <ngram/count_min_sketch.h>
+#include <ngram/hyper_log_log.h>
+#include <ngram/ngram_file.h>
+#include <ngram/ngram_router.h>
+#include <ngram/ngram_run.h>
+#include <ngram/ngram_sort.h>
+#include <ngram/ngram_table.h>
+#include <ngram/ngram_text_reader.h>
+#include <ngram/ngram_vector.h>
 #include <ngram/ngrams_base.h>
-#include <ngram/ternary_search_tree.h>
+#include <ngram/output_writer.h>
+#include <ngram/space_saving.h>
+
+/**
+ * receives the counted ngrams from Ngrams::visit
+ */
+class NgramVisitor {
+public:
+  virtual ~NgramVisitor() {}
+
+  /**
+   * called for each ngram
+   * @param	ngram - the readable ngram, as in the text output, only valid
+   *		during the call
+   * @param	length - length of the ngram
+   * @param	n - N of the ngram
+   * @param	frequency - times the ngram is seen
+   */
+  virtual void visit(const char *ngram, size_t length, int n,
+                     int64_t frequency) = 0;
+};
 
 /**
  * class for common ngram operations
+ *
+ * The input is either read from files, by the constructor of a subclass or
+ * addFiles, or held by the caller and passed in with feed or feedTokens and
+ * ended with finish. The counts are then written with output, or passed to
+ * a NgramVisitor with visit.
+ *
  * Revisions:
  * Feb 18, 2006. Jerry Yu
  * Initial implementation
@@ -39,16 +75,94 @@ WebSite: http://www.cs.dal.ca/~zyu
 
 class Ngrams : public INgrams {
 public:
+  /**
+   * @param	newInFileName - input counted by the constructor of a subclass,
+   *		empty for stdin, NULL for none, to load counts instead
+   */
   Ngrams(int newNgramN, const char *newInFileName, const char *newOutFileName,
          const char *newDelimiters = Config::getDefaultDelimiters(),
-         const char *newStopChars = Config::getDefaultStopChars());
+         const char *newStopChars = Config::getDefaultStopChars(),
+         const NgramOptions &newOptions = NgramOptions());
 
   ~Ngrams() {
-    releaseQueue();
+    delete ngramTable;
+    free(window);
+    delete[] tokenOffsets;
+    delete[] keyCursors;
     delete[] totals;
     delete[] uniques;
+    delete[] directCounts;
+    for (size_t i = 0; i < runs.count(); i++) {
+      delete runs[i];
+    }
+    for (size_t i = 0; i < mergedRuns.count(); i++) {
+      delete mergedRuns[i];
+    }
+    delete sketch;
+    if (heavyHitters) {
+      for (int i = 0; i < ngramN; i++) {
+        delete heavyHitters[i];
+      }
+      delete[] heavyHitters;
+    }
+    if (uniqueSketches) {
+      for (int i = 0; i < ngramN; i++) {
+        delete uniqueSketches[i];
+      }
+      delete[] uniqueSketches;
+    }
   }
 
+  /**
+   * read the whole input file and feed in all tokens.
+   * With options.threads > 1 a memory mapped input is split into one chunk
+   * per thread, each counted by a shard and merged in afterwards. With
+   * options.partitions > 1 as well, the shards route their ngrams to the
+   * threads owning the partitions of the table instead, unless they prune
+   * with options.maxMemory.
+   * With options.memoryLimit, the input is counted by this thread alone,
+   * spilling the table to sorted runs when it grows past the limit, and the
+   * runs are merged at the end into a run for each N, which is output from
+   * disk.
+   */
+  void addTokens();
+
+  /**
+   * read the input files one after the other and feed in all their tokens.
+   * Each file is tokenized on its own, ngrams span from one file into the
+   * next unless options.documentBoundaries is set. With options.threads > 1
+   * and several files, each shard counts a range of files of about the same
+   * size, reading on into the next files for the ngrams spanning them.
+   * Otherwise as addTokens.
+   * @param	fileNames - files to read, an empty name for stdin
+   */
+  void addFiles(const char *const *fileNames, int fileCount);
+
+  /**
+   * tokenize a block of input held in memory and feed in its tokens. A token
+   * may continue in the next block, the input is ended by finish. The block
+   * is counted by the calling thread, whatever options.threads is.
+   * @param	data - the bytes, only read during the call
+   * @param	length - number of bytes
+   */
+  void feed(const char *data, size_t length);
+
+  /**
+   * feed in tokens already split by the caller, same as addToken for each.
+   * @param	tokens - the tokens, only read during the call
+   * @param	lengths - length of each token
+   * @param	count - number of tokens
+   */
+  virtual void feedTokens(const char *const *tokens, const size_t *lengths,
+                          size_t count);
+
+  /**
+   * end the input fed in, its last token is fed in and the counts are
+   * complete afterwards. Input fed in later is counted as the next file of
+   * addFiles would be.
+   */
+  void finish();
+
   /**
    * feed a token in, the token will be processed internally to generating ngram
    *
@@ -58,19 +172,59 @@ public:
 
   virtual void addToken(const utf8_string &token);
 
+  /**
+   * feed a token of given length in, same as addToken( const utf8_string & )
+   * but without constructing a string for the token.
+   */
+  void addToken(const char *token, size_t length);
+
+  /**
+   * output the ngrams as text, or with options.format as a binary ngram
+   * count file
+   */
+  void output();
+
+  /**
+   * add the counts of a ngram count file, the text output or a binary ngram
+   * count file of the same kind of ngrams. Ngrams of N above getN() are
+   * skipped.
+   * @param	fileName - file to read, empty for stdin
+   * @return	false if the file can not be read or holds another kind of
+   *		ngrams
+   */
+  bool load(const char *fileName);
+
+  /**
+   * pass the ngrams seen at least options.minCount times to visitor, in the
+   * order of the table
+   * @param	n - N of the ngrams to visit, 0 for all
+   */
+  void visit(NgramVisitor &visitor, int n = 0);
+
   /**
    * set delimiters
    */
   void setDelimiters(const char *newDelimiters) {
     this->delimiters = newDelimiters;
+    this->delimiterSet.clear();
+    this->delimiterSet.add(newDelimiters);
+    // strchr used to find the terminating null, so NUL is always one
+    this->delimiterSet.add((unsigned char)0);
+    this->updateTokenBreaks();
   }
 
   void setStopChars(const char *newStopChars) {
     this->stopChars = newStopChars;
+    this->stopCharSet.clear();
+    this->stopCharSet.add(newStopChars);
+    this->stopCharSet.add((unsigned char)0);
+    this->updateTokenBreaks();
   }
 
   utf8_string &getInFileName() { return this->inFileName; }
 
+  utf8_string &getOutFileName() { return this->outFileName; }
+
   int getN() { return ngramN; }
 
   /**
@@ -78,25 +232,21 @@ public:
    * @param c - input character
    * @return true if c is set to be a delimiter
    */
-  bool isDelimiter(int c) const {
-    return strchr(this->delimiters.c_str(), c) != NULL;
-  }
+  bool isDelimiter(int c) const { return delimiterSet.contains(c); }
 
   /**
    * This methods return true if given char is set to be a stop char
    * @param c - input char
    * @return true if c is set to be a stop char
    */
-  bool isStopChar(int c) const {
-    return strchr(this->stopChars.c_str(), c) != NULL;
-  }
+  bool isStopChar(int c) const { return stopCharSet.contains(c); }
 
   /**
    * total ngrams ( duplications are counted ), which is total of frequency of
    * each ngram
    */
-  int total() {
-    int ret = 0;
+  int64_t total() {
+    int64_t ret = 0;
     for (int i = 1; i <= ngramN; i++) {
       ret += total(i);
     }
@@ -107,91 +257,586 @@ public:
    * total of frequency of each ngram
    */
 
-  int total(int n) { return n > 0 && n <= ngramN ? totals[n - 1] : 0; }
+  int64_t total(int n) { return n > 0 && n <= ngramN ? totals[n - 1] : 0; }
 
   /**
    * get total number of unique ngrams
    */
 
-  int count() { return ngramTable.count(); }
+  int64_t count() {
+    int64_t ret = 0;
+    for (int i = 1; i <= ngramN; i++) {
+      ret += count(i);
+    }
+    return ret;
+  }
 
   /**
    * get total number of unique ngrams for given N
    */
 
-  int count(int n) { return n > 0 && n <= ngramN ? uniques[n - 1] : 0; }
+  int64_t count(int n) { return n > 0 && n <= ngramN ? uniques[n - 1] : 0; }
+
+  /**
+   * get by how much frequencies may be too low since ngrams were pruned
+   * while counting, 0 if they were not
+   */
+  int64_t getPrunedCount() const { return prunedCount; }
+
+  /**
+   * true if the ngrams are counted approximately, with options.approximation
+   * set to Config::COUNT_MIN_SKETCH. Only the options.heavyHitters most
+   * frequent ngrams of each N are kept then, count( n ) is the number kept.
+   */
+  bool isApproximate() const { return sketch != NULL; }
+
+  /**
+   * get by how much approximate frequencies may be too high, with
+   * probability getConfidence(), 0 for exact counts
+   */
+  int64_t getErrorBound() {
+    return sketch ? sketch->getErrorBound(this->total()) : 0;
+  }
+
+  /**
+   * get the probability that approximate frequencies are within
+   * getErrorBound(), 1 for exact counts
+   */
+  double getConfidence() const { return sketch ? sketch->getConfidence() : 1; }
+
+  /**
+   * get the most times an approximately counted ngram may have been seen
+   * and still be left out, 0 for exact counts
+   */
+  int64_t getMissingCount() const;
+
+  /**
+   * true if only the unique ngrams are estimated, with options.approximation
+   * set to Config::HYPER_LOG_LOG. No ngrams are kept then, count( n ) is the
+   * estimate and total( n ) is exact.
+   */
+  bool isEstimatingUniques() const { return uniqueSketches != NULL; }
+
+  /**
+   * size the table for given number of unique ngrams of all N at once,
+   * rather than growing it while counting. Nothing is done when the table
+   * is bounded by options.maxMemory or options.memoryLimit, or not used.
+   */
+  void reserve(size_t expectedUniques);
+
+  /**
+   * get the relative standard error of count( n ), 0 for exact counts
+   */
+  double getUniquesError() const {
+    return uniqueSketches ? uniqueSketches[0]->getStandardError() : 0;
+  }
 
 protected:
-  TernarySearchTree<NgramValue> ngramTable;
+  /**
+   * create an empty ngram counter with the settings of parent, it does not
+   * read any input
+   */
+  explicit Ngrams(const Ngrams *parent)
+      : Ngrams(parent->ngramN, "", "", parent->delimiters.c_str(),
+               parent->stopChars.c_str(), parent->options) {}
+
+  NgramTable *ngramTable;
   utf8_string delimiters;
+  ByteSet tokenBreaks; // the delimiters and the stop chars
 
-  struct TokenNode {
-    utf8_string token;
-    TokenNode *next;
-    TokenNode(const char *newToken) : token(newToken), next(0) {}
-  };
+  int ngramN; // default number of ngrams
 
-  TokenNode *head, *tail;
+  /**
+   * set the character placed between two tokens of a ngram key, 0 for none.
+   */
+  void setTokenSeparator(char separator) { this->tokenSeparator = separator; }
 
-  int ngramN; // default number of ngrams
+  /**
+   * count the ngrams of N up to n, at most 2, in an array indexed by their
+   * bytes rather than in the table. Only for tokens of one byte without a
+   * separator. The counts are added to the table at the end of the input.
+   */
+  void enableDirectCounts(int n);
+
+  /**
+   * feed in each byte as a token, same as addToken( p, 1 ) for each, but
+   * counting them straight into the direct counts when all ngrams are
+   */
+  void addByteTokens(const char *begin, const char *end);
+
+  /**
+   * split a block of input into tokens and feed them in. The bytes are only
+   * valid during the call, a token may continue in the next block.
+   * @param	begin - first byte of the block
+   * @param	end - past the last byte of the block
+   */
+  virtual void tokenize(const char *begin, const char *end) = 0;
+
+  /**
+   * called at the end of an input, to feed in a token left unfinished by
+   * tokenize, so that the next input is tokenized from a fresh state
+   */
+  virtual void finishTokens() {}
+
+  /**
+   * get the ngrams of given N to output, all of them or the options.top most
+   * frequent ones ( by the order of INgrams::compareFunction ), seen at
+   * least options.minCount times. The most
+   * frequent are selected by streaming the frequencies through a bounded
+   * heap, so only the selected ngrams are decoded.
+   * @param	ngramVector - gets the ngrams, to be deleted by the caller
+   */
+  void getNgrams(ngram_vector<NgramToken *> &ngramVector, int n);
+
+  /**
+   * add the ngrams of given N and seen at least options.minCount times in a
+   * table to a vector, decoded for output. Only reads the table, so the
+   * partitions of a PartitionedNgramTable can be collected at once.
+   * @param	table - ngramTable or one of its partitions
+   * @param	ngramVector - gets the ngrams, to be deleted by the caller
+   */
+  void collectNgrams(NgramTable *table, int n,
+                     ngram_vector<NgramToken *> *ngramVector);
+
+  /**
+   * collect all the ngrams of given N in the partitions of ngramTable, with
+   * a thread per partition
+   */
+  void collectPartitions(ngram_vector<NgramToken *> &ngramVector, int n);
+
+  /**
+   * sort ngrams got by getNgrams for output, by descending frequency then by
+   * ngram, with options.threads threads
+   */
+  void sortNgrams(ngram_vector<NgramToken *> &ngramVector) {
+    NgramSort::sortByFrequency(ngramVector, options.threads);
+  }
+
+  /**
+   * write the ngrams of given N got by getNgrams, sorted by sortNgrams. When
+   * they were merged from spilled runs and options.top keeps them all, they
+   * are sorted on disk instead.
+   */
+  void writeNgrams(OutputWriter &out, int n);
+
+  /**
+   * write the header and the ngrams as text
+   */
+  virtual void outputText() = 0;
+
+  /**
+   * write the line telling how far approximate counts may be off, nothing
+   * for exact counts
+   */
+  void writeApproximation(OutputWriter &out);
+
+  /**
+   * get the kind of ngrams, Config::WORD_NGRAM, CHAR_NGRAM or BYTE_NGRAM
+   */
+  virtual int getType() const = 0;
+
+  /**
+   * add the words of a binary ngram count file to writer, none by default
+   */
+  virtual void writeVocabulary(NgramFileWriter &writer) {}
+
+  /**
+   * convert a ngram key into the key of a binary ngram count file, by default
+   * the key itself
+   * @param	fileKey - the key is appended to it
+   */
+  virtual void encodeFileKey(const char *key, size_t length, int n,
+                             utf8_string &fileKey) {
+    fileKey.append(key, length);
+  }
+
+  /**
+   * whether file keys sort in another order than the ngram keys they encode,
+   * false by default
+   */
+  virtual bool reordersFileKeys() const { return false; }
+
+  /**
+   * convert the key of a binary ngram count file into a ngram key, the
+   * inverse of encodeFileKey, by default the key itself
+   * @param	key - the key is appended to it
+   * @return	false if the file key is corrupt
+   */
+  virtual bool decodeFileKey(const NgramFileReader &reader,
+                             const char *fileKey, size_t length, int n,
+                             utf8_string &key) {
+    key.append(fileKey, length);
+    return true;
+  }
+
+  /**
+   * convert a readable ngram into a ngram key, the inverse of decodeNgram, by
+   * default the ngram itself
+   * @param	key - the key is appended to it
+   * @return	false if the ngram can not be converted
+   */
+  virtual bool encodeNgram(const char *ngram, size_t length, int n,
+                           utf8_string &key) {
+    key.append(ngram, length);
+    return true;
+  }
+
+  /**
+   * convert a ngram key into readable ngram, by default the key itself
+   * @param	ngram - the ngram is appended to it
+   */
+  virtual void decodeNgram(const char *key, size_t length, int n,
+                           utf8_string &ngram) {
+    ngram.append(key, length);
+  }
+
+  /**
+   * create an empty counter of the same kind and settings, which counts one
+   * chunk of the input in its own thread
+   */
+  virtual Ngrams *createShard() = 0;
+
+  /**
+   * find where a chunk of the input can start, so that tokenizing from there
+   * with a fresh tokenizer state gives the same tokens as tokenizing the whole
+   * input. The default suits tokenizers that keep no state between bytes.
+   * @param	p - position to start looking from
+   * @param	end - end of the input
+   * @return	the first such position not before p, or end
+   */
+  virtual const char *findShardStart(const char *p, const char *end) const {
+    return p;
+  }
+
+  /**
+   * add all ngrams counted by shard, with their frequencies
+   */
+  virtual void merge(Ngrams &shard);
+
+  /**
+   * merge a shard in, taking its totals and pruned count as they are, since
+   * the ngrams it pruned are no longer in its table
+   */
+  void mergeShard(Ngrams &shard);
+
+  /**
+   * true for a shard routing its ngrams to the partition owners, rather than
+   * counting them in its own table
+   */
+  bool isRouted() const { return router != NULL; }
 
   /**
    * add a ngram to the ngram list.
    * if it is not on the list, add it, otherwise increase the ngram frequent
-   * count by 1
+   * count by frequency
+   * @param	length - length of the ngram
    * @param	n - number of the ngram
+   * @param	frequency - times the ngram is seen
    */
 
-  void addNgram(const char *ngram, int n);
+  void addNgram(const char *ngram, size_t length, int n,
+                int64_t frequency = 1) {
+    if (sketch || uniqueSketches) {
+      addApproximateNgram(ngram, length, n, frequency);
+      return;
+    }
+    addNgram(ngramTable->advance(ngramTable->getCursor(), ngram, length), ngram,
+             length, n, frequency);
+  }
 
   /**
-   * get all the items( key & value pairs ) in the tree
-   * @param	n - n of ngram
-   * @return	ngram_vector that contains all the item pointers
+   * same as addNgram( ngram, length, n, frequency ), for a ngram whose chars
+   * have already been walked by the given cursor of the ngram table.
    */
-  ngram_vector<TstItem<NgramValue> *> &getItems() {
-    return ngramTable.getItems();
+  void addNgram(NgramTable::Cursor cursor, const char *ngram, size_t length,
+                int n, int64_t frequency = 1) {
+    assert(n > 0 && n <= ngramN);
+    bool added;
+    ngramTable->add(cursor, ngram, length, n, added)->frequency += frequency;
+    if (added) {
+      ++uniques[n - 1];
+    }
+    totals[n - 1] += frequency;
   }
 
 private:
   utf8_string inFileName;  // input text file name
   utf8_string outFileName; // output text file name
   utf8_string stopChars;
-  int tokenCount; // used for counting when parsing text
-  int *totals;    // array for count total grams ( duplicated are counted ) for
-                  // each N
-  int *uniques;   // array for counting unique grams for each each N
+  ByteSet delimiterSet;
+  ByteSet stopCharSet;
+  NgramOptions options;
+  int tokenCount;   // number of tokens in the queue, at most ngramN
+  int64_t *totals;  // array for count total grams ( duplicated are counted )
+                    // for each N
+  int64_t *uniques; // array for counting unique grams for each each N
 
   /**
-   * add token to the queue. The queue will be used to generate ngram
-   * @param	token - token to be added to the queue.
-   * @return	total number of tokens in the queue
+   * The token queue is a ring of ngramN offsets into window, a byte buffer
+   * holding the queued tokens back to back ( joined by tokenSeparator ). Every
+   * ngram ending at the newest token is then a suffix of the window, so ngram
+   * keys are looked up in place instead of being concatenated per token.
+   * The window is compacted when full, no memory is allocated per token.
    */
-  int pushQueue(const char *token);
+  char *window;                   // queued tokens, null terminated
+  size_t windowLength;            // bytes used in window
+  size_t windowSize;              // bytes allocated for window
+  size_t *tokenOffsets;           // ring of token start offsets in window
+  NgramTable::Cursor *keyCursors; // ring of ngram table cursors
+  int queueHead;                  // ring slot of the oldest token
+  char tokenSeparator; // char between tokens of a ngram key, 0 for none
 
-  void popQueue();
+  /**
+   * A shard counts the ngrams starting in its chunk, so after the chunk it
+   * reads up to ngramN - 1 overflow tokens of the next chunk, and only the
+   * ngrams ending at the k-th of them with more than k tokens are counted.
+   */
+  bool overflowing;   // whether tokens fed in are past the shard's chunk
+  int overflowTokens; // overflow tokens fed in so far
+
+  NgramRouter *router; // router of a routed shard, NULL otherwise
+  int producer;        // producer index of a routed shard
+
+  int64_t prunedCount;       // most occurrences lost by pruning, 0 for none
+  unsigned pruneCheckTokens; // tokens since the table size was checked
+
+  ngram_vector<NgramRun *> runs;       // runs spilled with options.memoryLimit
+  ngram_vector<NgramRun *> mergedRuns; // ngrams of each N merged from runs,
+                                       // in key order, empty for none
+
+  enum { DIRECT_COUNTS = 256 + 65536 }; // 1-grams, then 2-grams
+  static const uint32_t DIRECT_FLUSH_TOKENS = 0xffffffff; // before overflow
+  int directN;            // ngrams of N up to this are counted in directCounts
+  uint32_t *directCounts; // counts indexed by bytes, NULL when directN is 0
+  size_t directTokens;    // tokens counted directly since the last flush
+
+  CountMinSketch *sketch;       // approximate counts, NULL for exact counts
+  SpaceSaving **heavyHitters;   // most frequent ngrams of each N, with sketch
+  HyperLogLog **uniqueSketches; // unique ngrams of each N, NULL for exact
+                                // counts
+
+  enum {
+    UNIQUES_SAMPLE_BYTES = 1 << 22, // input sampled by sampleUniques
+    UNIQUES_SAMPLE_SLICES = 16      // slices the sample is spread over
+  };
 
   /**
-   * Generate ngrams when queue has NGRAM_N - 1 tokens.
-   * the token queue need to be processed specially for the first NGRAM_N - 1
-   * tokens, also need to be called if less than NGRAM_N tokens in the whole
-   * input text.
-   * @param	count - total items in the queue
+   * add the direct counts to the table and clear them
    */
-  virtual void preParse(int count) = 0;
+  void flushDirectCounts();
 
   /**
-   * Once the queue is full, it will start to pop out ngrams
-   * for each new token pushing in
+   * rebuild tokenBreaks from the delimiters and the stop chars
    */
-  virtual void parse(){};
+  void updateTokenBreaks() {
+    tokenBreaks.clear();
+    tokenBreaks.add(delimiterSet);
+    tokenBreaks.add(stopCharSet);
+  }
 
-  // release queue memory
-  void releaseQueue() {
-    while (tokenCount > 0) {
-      popQueue();
-    }
+  /**
+   * With options.maxMemory, when the table grows past it, the ngrams seen
+   * once are dropped, then those seen twice and so on, until the table is
+   * within half the budget. Counts are lossy afterwards: a pruned ngram seen
+   * again starts from 0, and count( n ) is the number of unique ngrams kept.
+   */
+  void prune();
+
+  /**
+   * With options.memoryLimit, when the table grows past it, its ngrams are
+   * written to a new run sorted by NgramRun::compare and the table is
+   * emptied. uniques are only right again once the runs are merged.
+   * @return	false if the run file can not be created, counting goes on in
+   *		memory then
+   */
+  bool spill();
+
+  /**
+   * spill the table one last time, then merge all the runs and mergedRuns
+   * into mergedRuns, adding up the frequencies of a ngram from all runs. All
+   * ngrams are kept, as a later input may bring them up to options.minCount,
+   * which is applied when they are output. If a run file can not be created,
+   * the runs are merged into the table.
+   */
+  void mergeRuns();
+
+  /**
+   * add the ngrams of mergedRuns to the table and delete the runs, for the
+   * uses that need them in memory
+   */
+  void loadMergedRuns();
+
+  /**
+   * write the ngrams of given N in mergedRuns seen at least options.minCount
+   * times as text, in the order of sortNgrams, sorting them in runs within
+   * options.memoryLimit
+   * @return	false if a run file failed
+   */
+  bool writeMergedNgrams(OutputWriter &out, int n);
+
+  /**
+   * add the ngrams of given N in mergedRuns seen at least options.minCount
+   * times to writer, in the order of their file keys. They are written as
+   * read unless reordersFileKeys().
+   * @return	false if a run file failed
+   */
+  bool writeMergedNgrams(NgramFileWriter &writer, int n);
+
+  /**
+   * point the cursors of the queued tokens into a new table
+   */
+  void resetCursors();
+
+  /**
+   * write the ngrams seen at least options.minCount times into a binary
+   * ngram count file, keys of each N sorted
+   */
+  void outputBinary();
+
+  /**
+   * add the counts of an opened binary ngram count file
+   */
+  bool loadBinary(const NgramFileReader &reader, const char *fileName);
+
+  /**
+   * add the counts of an opened text output
+   */
+  bool loadText(NgramTextReader &reader, const char *fileName);
+
+  /**
+   * the part of the input counted by one shard, a chunk of a memory mapped
+   * input or a range of input files
+   */
+  struct ShardInput {
+    const char *begin;            // first byte of the chunk
+    const char *chunkEnd;         // past the last byte of the chunk
+    const char *end;              // past the last byte of the input
+    const char *const *fileNames; // all input files, NULL for a chunk
+    int firstFile;                // first file of the range
+    int lastFile;                 // past the last file of the range
+    int fileCount;                // number of input files
+  };
+
+  /**
+   * count the input with options.threads shards
+   * @param	begin - first byte of the input
+   * @param	end - past the last byte of the input
+   */
+  void addTokensInParallel(const char *begin, const char *end);
+
+  /**
+   * count the input files with options.threads shards
+   */
+  void addFilesInParallel(const char *const *fileNames, int fileCount);
+
+  /**
+   * count each input with a shard, this one counting the first, and merge
+   * the shards in
+   */
+  void countInParallel(const ShardInput *inputs, int shardCount);
+
+  /**
+   * count each input with a routed shard, and fill the partitions of the
+   * table with a thread each
+   */
+  void countInPartitions(const ShardInput *inputs, int shardCount);
+
+  /**
+   * count the ngrams starting in the input of a shard
+   */
+  void countShard(const ShardInput *input);
+
+  /**
+   * count the ngrams starting in the chunk [ begin, chunkEnd ) of the input
+   * @param	end - end of the whole input
+   */
+  void countChunk(const char *begin, const char *chunkEnd, const char *end);
+
+  /**
+   * count the ngrams starting in the files [ firstFile, lastFile )
+   */
+  void countFiles(const char *const *fileNames, int firstFile, int lastFile,
+                  int fileCount);
+
+  /**
+   * tokenize overflow tokens until ngramN - 1 of them are fed in
+   * @return	where tokenizing stopped, end if all the bytes were tokenized
+   */
+  const char *tokenizeOverflow(const char *begin, const char *end);
+
+  /**
+   * finish the tokens of an input file, and with options.documentBoundaries
+   * empty the queue, so that no ngram spans two files
+   */
+  void endFile();
+
+  /**
+   * at the end of the input, add the direct counts to the table and merge
+   * the spilled runs, or fill the table with the heavy hitters
+   * when counting approximately, or take the unique estimates
+   */
+  void endInput();
+
+  /**
+   * count a ngram in the sketch and the heavy hitters of its N, or in the
+   * unique sketch of its N
+   */
+  void addApproximateNgram(const char *ngram, size_t length, int n,
+                           int64_t frequency);
+
+  /**
+   * refill the table with the heavy hitters of each N, each with the lower
+   * of its two estimated frequencies
+   */
+  void collectHeavyHitters();
+
+  /**
+   * true if the table may be sized up front, it is neither bounded by a
+   * memory budget nor replaced by sketches
+   */
+  bool isSizable() const {
+    return !options.maxMemory && !options.memoryLimit && !sketch &&
+           !uniqueSketches;
   }
+
+  /**
+   * create a HyperLogLog sketch of given precision for each N
+   */
+  void enableUniqueSketches(int precision);
+
+  /**
+   * estimate the unique ngrams of all N in the input files from a sample
+   * of them, 0 if they are not all regular files. Mapped files are only read
+   * where sampled, other files are read up to the last slice.
+   */
+  size_t sampleUniques(const char *const *fileNames, int fileCount);
+
+  /**
+   * add the unique sketches and the totals of a shard counted with them
+   */
+  void mergeUniques(const Ngrams &shard);
+
+  /**
+   * add token to the queue. The queue will be used to generate ngram
+   * @param	token - token to be added to the queue.
+   * @param	length - length of the token
+   * @return	total number of tokens in the queue
+   */
+  int pushQueue(const char *token, size_t length);
+
+  /**
+   * drop the oldest token from the queue
+   */
+  void popQueue();
+
+  /**
+   * add all the ngrams ending at the newest token of the queue, which are
+   * the 1..tokenCount grams made of the queue suffixes.
+   * The ngram starting at each queued token is the one started there on the
+   * previous call extended by the newest token, so each queued token keeps a
+   * table cursor that is only advanced over the new chars.
+   */
+  void parse();
 };
 
 #endif
@@ -28,6 +28,8 @@ WebSite: http://www.cs.dal.ca/~zyu
 
 #include <ngram/utf8_string.h>
 
+#include <stdint.h>
+
 /**
  * Define the interface for ngram classes
  * Revisions:
@@ -36,13 +38,20 @@ WebSite: http://www.cs.dal.ca/~zyu
  */
 class INgrams {
 public:
+  /**
+   * N and frequency of a ngram, packed in 64 bits so that table items stay
+   * small while counts go well beyond 2^32
+   */
   struct NgramValue {
-    int n; // N of ngram
-    int frequency;
+    uint64_t n : 8;         // N of ngram, up to MAX_N
+    int64_t frequency : 56; // times the ngram is seen
     NgramValue() : n(0), frequency(0) {}
-    NgramValue(int newN, int newFrequency) : n(newN), frequency(newFrequency) {}
+    NgramValue(int newN, int64_t newFrequency)
+        : n(newN), frequency(newFrequency) {}
   };
 
+  enum { MAX_N = 255 }; // the largest N a ngram value can hold
+
   struct NgramToken {
     NgramToken() {}
     NgramToken(utf8_string &newNgram, NgramValue &newValue) {
@@ -159,14 +168,27 @@ public:
   static int compareFunction(const void *a,
                              const void *b) /* sort by frequency and word */
   {
-    int freq1 = (*((NgramToken **)a))->value.frequency;
-    int freq2 = (*((NgramToken **)b))->value.frequency;
+    int64_t freq1 = (*((NgramToken **)a))->value.frequency;
+    int64_t freq2 = (*((NgramToken **)b))->value.frequency;
     return freq1 > freq2
                ? -1
                : freq1 == freq2 ? strcmp(((*(NgramToken **)a))->ngram.c_str(),
                                          (*((NgramToken **)b))->ngram.c_str())
                                 : 1;
   }
+
+  /**
+   * the order of compareFunction as a less than comparator for std::sort,
+   * more frequent ngrams first, then ngrams of the same frequency by bytes
+   */
+  struct FrequencyOrder {
+    bool operator()(const NgramToken *a, const NgramToken *b) const {
+      if (a->value.frequency != b->value.frequency) {
+        return a->value.frequency > b->value.frequency;
+      }
+      return strcmp(a->ngram.c_str(), b->ngram.c_str()) < 0;
+    }
+  };
   /**
    * constructor
    */
@@ -196,12 +218,12 @@ public:
   /**
    * get total number of ngrams
    */
-  virtual int count() = 0;
+  virtual int64_t count() = 0;
 
   /**
    * get total number ngrams for given N
    */
-  virtual int count(int n) = 0;
+  virtual int64_t count(int n) = 0;
 };
 
 #endif
@@ -0,0 +1,141 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _OUTPUT_WRITER_H_
+#define _OUTPUT_WRITER_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <charconv>
+
+/**
+ * Writes the output to a file or stdout through a large buffer.
+ *
+ * The buffer is written with write(2), bypassing stdio and its locking, and
+ * numbers are formatted with std::to_chars, so writing a ngram line costs
+ * no printf.
+ */
+class OutputWriter {
+public:
+  OutputWriter();
+
+  ~OutputWriter() { close(); }
+
+  /**
+   * open the output
+   * @param	fileName - file to write, created or truncated, empty for stdout
+   * @return	false if the file can not be opened
+   */
+  bool open(const char *fileName);
+
+  /**
+   * write bytes
+   */
+  void write(const char *text, size_t length) {
+    if (BUFFER_SIZE - bufferLength < length) {
+      flush();
+      if (length >= BUFFER_SIZE) {
+        writeAll(text, length);
+        return;
+      }
+    }
+    memcpy(buffer + bufferLength, text, length);
+    bufferLength += length;
+  }
+
+  /**
+   * write a null terminated string
+   */
+  void write(const char *text) { write(text, strlen(text)); }
+
+  void write(char c) {
+    if (bufferLength == BUFFER_SIZE) {
+      flush();
+    }
+    buffer[bufferLength++] = c;
+  }
+
+  /**
+   * write an integer in decimal
+   */
+  void writeNumber(int64_t value) {
+    if (BUFFER_SIZE - bufferLength < MAX_NUMBER_LENGTH) {
+      flush();
+    }
+    bufferLength =
+        std::to_chars(buffer + bufferLength, buffer + BUFFER_SIZE, value).ptr -
+        buffer;
+  }
+
+  /**
+   * write a ngram line, the ngram and its frequency separated by a tab
+   */
+  void writeNgram(const char *ngram, size_t length, int64_t frequency) {
+    write(ngram, length);
+    write('\t');
+    writeNumber(frequency);
+    write('\n');
+  }
+
+  /**
+   * write formatted text, as printf
+   */
+  void format(const char *format, ...);
+
+  /**
+   * write out the buffered bytes
+   */
+  void flush();
+
+  /**
+   * flush and close the output
+   */
+  void close();
+
+  /**
+   * true if writing the output failed
+   */
+  bool hasFailed() const { return failed; }
+
+private:
+  enum {
+    BUFFER_SIZE = 4 << 20,  // bytes buffered
+    MAX_NUMBER_LENGTH = 24, // longest integer written
+    STDOUT = 1              // file descriptor of stdout
+  };
+
+  int fd;              // output, -1 when closed
+  char *buffer;        // buffered bytes
+  size_t bufferLength; // bytes in buffer
+  bool failed;         // whether a write failed
+
+  void writeAll(const char *data, size_t length);
+
+  OutputWriter(const OutputWriter &);
+  void operator=(const OutputWriter &);
+};
+
+#endif
@@ -0,0 +1,135 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _PARTITIONED_NGRAM_TABLE_H_
+#define _PARTITIONED_NGRAM_TABLE_H_
+
+#include <ngram/hash_ngram_table.h>
+
+#include <atomic>
+
+/**
+ * Ngram table made of independent sub tables, each owning the keys whose hash
+ * falls in its partition. The partitions share no state, so each can be
+ * filled by its own thread ( see NgramRouter ) without locks or a merge.
+ *
+ * Items are numbered partition by partition, an item is found by a binary
+ * search of the partition starts. Cursors are the running FNV-1a hash of the
+ * key, as in HashNgramTable.
+ */
+class PartitionedNgramTable : public NgramTable {
+public:
+  /**
+   * @param	partitionCount - number of sub tables
+   * @param	tableType - type of the sub tables
+   */
+  PartitionedNgramTable(int partitionCount, int tableType);
+
+  virtual ~PartitionedNgramTable();
+
+  Cursor getCursor() { return HashNgramTable::FNV_OFFSET_BASIS; }
+
+  Cursor advance(Cursor cursor, const char *key, size_t length) {
+    const unsigned char *p = (const unsigned char *)key;
+    for (size_t i = 0; i < length; i++) {
+      cursor = (cursor ^ p[i]) * HashNgramTable::FNV_PRIME;
+    }
+    return cursor;
+  }
+
+  NgramValue *add(Cursor cursor, const char *key, size_t length, int n,
+                  bool &added) {
+    return add(getPartition(cursor), cursor, key, length, n, added);
+  }
+
+  /**
+   * add a key to the sub table of its partition. Hash sub tables take the
+   * cursor as it is, as they hash keys the same way, other sub tables walk
+   * the key again. The partitions may be filled by their own threads at once.
+   */
+  NgramValue *add(int partition, Cursor cursor, const char *key,
+                  size_t length, int n, bool &added) {
+    NgramValue *value =
+        hashPartitions
+            ? partitions[partition]->add(cursor, key, length, n, added)
+            : partitions[partition]->add(key, length, n, added);
+    // only written once until the items are looked up again, so the
+    // partition threads do not keep taking the cache line from each other
+    if (added && !startsStale.load(std::memory_order_relaxed)) {
+      startsStale.store(true, std::memory_order_relaxed);
+    }
+    return value;
+  }
+
+  size_t count() const;
+
+  const char *getKey(size_t index, size_t &length);
+
+  NgramValue &getValue(size_t index);
+
+  size_t getMemoryUsage() const;
+
+  void reserve(size_t keyCount);
+
+  int getPartitionCount() const { return partitionCount; }
+
+  /**
+   * get the partition owning the key a cursor was advanced over
+   */
+  int getPartition(Cursor cursor) const {
+    // high bits, the low ones pick slots in hash sub tables
+    return (int)(((HashNgramTable::mix(cursor) >> 32) * partitionCount) >> 32);
+  }
+
+  /**
+   * get the sub table of a partition
+   */
+  NgramTable *getTable(int partition) { return partitions[partition]; }
+
+private:
+  int partitionCount;
+  NgramTable **partitions;
+  bool hashPartitions; // the sub tables are HashNgramTables
+  size_t *starts;      // number of the first item of each partition, and count
+  std::atomic<bool> startsStale; // keys were added since starts were updated
+
+  /**
+   * number the items of the partitions again
+   */
+  void updateStarts();
+
+  /**
+   * find the partition of an item, and the item index within it
+   *
+   * @param	index - item index, set to the index within the partition
+   * @return	sub table of the partition
+   */
+  NgramTable *findItem(size_t &index);
+
+  PartitionedNgramTable(const PartitionedNgramTable &);
+  void operator=(const PartitionedNgramTable &);
+};
+
+#endif
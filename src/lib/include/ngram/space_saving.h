@@ -0,0 +1,129 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _SPACE_SAVING_H_
+#define _SPACE_SAVING_H_
+
+#include <ngram/utf8_string.h>
+
+#include <stdint.h>
+
+/**
+ * Space-Saving heavy hitters, the most frequent keys of a stream counted in
+ * a fixed number of counters.
+ *
+ * Once all counters are taken, a key not counted yet takes over the counter
+ * of the least frequent key, and the count it starts from is its error. So
+ * a count is never too low and too high by at most its error, and every key
+ * seen more than getMinCount() times has a counter.
+ *
+ * The counters are kept in a min heap by count, and found by key through an
+ * open addressing hash index.
+ */
+class SpaceSaving {
+public:
+  /**
+   * @param	capacity - number of counters
+   */
+  explicit SpaceSaving(size_t capacity);
+
+  ~SpaceSaving();
+
+  /**
+   * add frequency to the count of a key
+   * @param	hash - hash of the key
+   */
+  void add(const char *key, size_t length, uint64_t hash, int64_t frequency);
+
+  /**
+   * get number of keys counted, at most the capacity
+   */
+  size_t count() const { return entryCount; }
+
+  /**
+   * get the key of a counter, counters are in no particular order
+   */
+  const char *getKey(size_t index, size_t &length) const {
+    length = entries[index].key.length();
+    return entries[index].key.c_str();
+  }
+
+  uint64_t getHash(size_t index) const { return entries[index].hash; }
+
+  /**
+   * get the count of a counter, at least the frequency of its key
+   */
+  int64_t getCount(size_t index) const { return entries[index].count; }
+
+  /**
+   * get by how much the count of a counter may be too high
+   */
+  int64_t getError(size_t index) const { return entries[index].error; }
+
+  /**
+   * get the count of the least frequent key once all counters are taken, 0
+   * before. Keys seen more often are all counted.
+   */
+  int64_t getMinCount() const {
+    return entryCount < capacity ? 0 : entries[heap[0]].count;
+  }
+
+private:
+  struct Entry {
+    utf8_string key;
+    uint64_t hash;
+    int64_t count;
+    int64_t error;
+    size_t heapIndex; // position of the entry in heap
+  };
+
+  Entry *entries;
+  size_t *heap;      // entry indexes, min heap by count
+  size_t *slots;     // entry index + 1 per slot, 0 for an empty slot
+  size_t slotMask;   // number of slots - 1, a power of 2 - 1
+  size_t capacity;   // number of entries
+  size_t entryCount; // entries in use
+
+  /**
+   * get the slot holding a key, or the empty slot it goes into
+   */
+  size_t findSlot(const char *key, size_t length, uint64_t hash) const;
+
+  /**
+   * empty a slot, moving back the keys probed past it
+   */
+  void removeSlot(size_t slot);
+
+  /**
+   * restore the heap order after the count at position went down or up
+   */
+  void siftUp(size_t position);
+  void siftDown(size_t position);
+
+  SpaceSaving(const SpaceSaving &);
+  void operator=(const SpaceSaving &);
+};
+
+#endif
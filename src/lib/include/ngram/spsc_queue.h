@@ -0,0 +1,89 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Bounded lock free queue passing objects from one producer thread to one
+ * consumer thread.
+ */
+template <class Object> class spsc_queue {
+public:
+  /**
+   * @param	capacity - most objects queued at once, rounded up to a power of 2
+   */
+  explicit spsc_queue(size_t capacity = 64) : size(1), head(0), tail(0) {
+    while (size < capacity) {
+      size <<= 1;
+    }
+    objects = new Object[size];
+  }
+
+  ~spsc_queue() { delete[] objects; }
+
+  /**
+   * add an object at the tail, called by the producer only
+   * @return	false if the queue is full
+   */
+  bool push(const Object &object) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == size) {
+      return false;
+    }
+    objects[t & (size - 1)] = object;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * remove the object at the head, called by the consumer only
+   * @return	false if the queue is empty
+   */
+  bool pop(Object &object) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    object = objects[h & (size - 1)];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  Object *objects;
+  size_t size;
+  // head and tail on their own cache lines, written by different threads
+  alignas(64) std::atomic<size_t> head; // next object to pop
+  alignas(64) std::atomic<size_t> tail; // next free place to push
+
+  spsc_queue(const spsc_queue &);
+  void operator=(const spsc_queue &);
+};
+
+#endif
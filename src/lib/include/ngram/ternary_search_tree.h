@@ -60,14 +60,16 @@ WebSite: http://www.cs.dal.ca/~zyu
 // uncomment following define to display tree infomation
 //#define TST_INFO_ENABLE
 
+#include <ngram/ngram_arena.h>
 #include <ngram/ngram_vector.h>
 #include <ngram/utf8_string.h>
 
 /**
- * define tree node structure
+ * define tree node structure. Nodes live in the node arena of their tree and
+ * link each other by 32 bits index, 0 for none.
  */
 
-typedef struct TstNode *TstTree;
+typedef uint32_t TstTree;
 
 typedef struct TstNode {
   TstNode(char c) : splitChar(c), left(0), right(0), mid(0) {}
@@ -75,7 +77,7 @@ typedef struct TstNode {
   TstTree left, right;
   union {
     TstTree mid;
-    int index;
+    uint32_t index;
   };
 } tstNode;
 
@@ -87,17 +89,16 @@ template <class Object> struct TstItem {
   TstItem(const utf8_string &newKey, const Object &newValue)
       : key(newKey), value(newValue) {}
 
-  TstItem() {}
+  TstItem(const char *newKey, size_t length, const Object &newValue)
+      : value(newValue) {
+    key.append(newKey, length);
+  }
 
-  ~TstItem() {}
+  TstItem() {}
 
   utf8_string key;
   Object value;
 
-  void operator=(const TstItem &item) {
-    key = item.key;
-    value = item.value;
-  }
   bool operator>(const TstItem &item) const { return key > item.key; }
   bool operator==(const TstItem &item) const { return key == item.key; }
   bool operator<(const TstItem &item) const { return key < item.key; }
@@ -145,7 +146,7 @@ public:
    */
 
   inline TstItem<Object> *getItem(const char *key) {
-    int index = this->getItemIndex(key);
+    ptrdiff_t index = this->getItemIndex(key);
     return index == -1 ? NULL : itemngram_vector[index];
   }
 
@@ -156,8 +157,8 @@ public:
    * @return	pointer to the item, NULL if not found
    */
 
-  inline TstItem<Object> *getItem(int index) {
-    assert(index >= 0 && index < itemCount);
+  inline TstItem<Object> *getItem(size_t index) {
+    assert(index < itemCount);
     return itemngram_vector[index];
   }
 
@@ -172,7 +173,7 @@ public:
    * @return	The key of the item with specified index, NULL if not found
    */
 
-  inline const char *getKey(int index) {
+  inline const char *getKey(ptrdiff_t index) {
     return index == -1 ? NULL : itemngram_vector[index]->key.c_str();
   }
 
@@ -184,7 +185,7 @@ public:
    */
 
   inline Object *getValue(const char *key) {
-    int index = this->getItemIndex(key);
+    ptrdiff_t index = this->getItemIndex(key);
     return index == -1 ? NULL : &(itemngram_vector[index]->value);
   }
 
@@ -195,7 +196,7 @@ public:
    * @return	pointer to the value, NULL if not found
    */
 
-  Object *getValue(int index) {
+  Object *getValue(ptrdiff_t index) {
     return index == -1 ? NULL : &(itemngram_vector[index]->value);
   }
 
@@ -208,24 +209,25 @@ public:
    * return -1
    */
 
-  int getItemIndex(const char *key) {
-    int index = -1; /* index of the key in keyngram_vector */
+  ptrdiff_t getItemIndex(const char *key) {
+    ptrdiff_t index = -1; /* index of the key in keyngram_vector */
     int diff, sc = *key;
     TstTree p = root;
 
     while (p) {
-      if ((diff = sc - p->splitChar) == 0) {
+      const TstNode &node = nodes[p];
+      if ((diff = sc - node.splitChar) == 0) {
         if (sc == 0) // found the key
         {
-          index = p->index; // get the index of the key
+          index = node.index; // get the index of the key
           break;
         }
         sc = *++key;
-        p = p->mid;
+        p = node.mid;
       } else if (diff < 0)
-        p = p->left;
+        p = node.left;
       else
-        p = p->right;
+        p = node.right;
     }
     // if index -1, that means the search has run off the end of the tree, the
     // key not found
@@ -241,7 +243,7 @@ public:
    * @return	an index ngram_vector for all returned keys
    */
 
-  ngram_vector<int> partialMatchSearch(const char *key);
+  ngram_vector<size_t> partialMatchSearch(const char *key);
 
   /**
    * Search near neighbors that are withing a given Hamming distance of the key.
@@ -255,8 +257,8 @@ public:
    *
    */
 
-  ngram_vector<int> nearSearch(const char *key, int distance) {
-    ngram_vector<int> nearngram_vector;
+  ngram_vector<size_t> nearSearch(const char *key, int distance) {
+    ngram_vector<size_t> nearngram_vector;
     nearngram_vectorPtr = &nearngram_vector;
     nearSearch(root, key, distance);
     return nearngram_vector;
@@ -272,7 +274,7 @@ public:
    * pattern for current implementation.
    */
 
-  ngram_vector<int> prefixSearch(const char *prefix) {
+  ngram_vector<size_t> prefixSearch(const char *prefix) {
     // string str( prefix );
     // str.append('*');
     return partialMatchSearch(utf8_string(prefix).append('*').c_str());
@@ -282,7 +284,7 @@ public:
    * print the strings in the tree in sorted order with a recursive traversal
    */
 
-  ngram_vector<int> getSortedItemIndexes();
+  ngram_vector<size_t> getSortedItemIndexes();
 
   /**
    * Adds an element with the specified key and value into the ternary search
@@ -294,11 +296,75 @@ public:
 
   TstNode *add(const char *key, const Object &value);
 
+  /**
+   * A cursor is the link of the tree a search continues from. Keys sharing a
+   * prefix can be built incrementally by advancing a cursor, instead of
+   * walking the whole key from the root for every lookup.
+   */
+  typedef TstTree *Cursor;
+
+  /**
+   * get a cursor positioned at the root, before the first char of any key
+   */
+  Cursor getCursor() { return &root; }
+
+  /**
+   * Advance a cursor over the given chars. Nodes for chars not yet in the
+   * tree are inserted on the way, so the key is expected to be added.
+   *
+   * @param	cursor - cursor to advance
+   * @param	key - chars to walk, must not contain the null char
+   * @param	length - number of chars to walk
+   * @return	cursor positioned after the last char
+   */
+  Cursor advance(Cursor cursor, const char *key, size_t length);
+
+  /**
+   * get value of the key ending at the cursor
+   *
+   * @param	cursor - cursor positioned after the last char of a key
+   * @return	pointer to the value, NULL if key not found
+   */
+  Object *getValue(Cursor cursor) {
+    TstTree p = *findEnd(cursor);
+    return p ? &(itemngram_vector[nodes[p].index]->value) : NULL;
+  }
+
+  /**
+   * Adds an element with the key ending at the cursor into the tree
+   *
+   * @param	cursor - cursor positioned after the last char of the key
+   * @param	key - the whole key, stored with the item
+   * @param	length - length of the key
+   * @param	value - value of the element
+   * @return	the leaf node of the key
+   */
+  TstNode *add(Cursor cursor, const char *key, size_t length,
+               const Object &value);
+
   /**
    * Get total number of key & value pair in the tree
    */
 
-  int count() const { return itemCount; }
+  size_t count() const { return itemCount; }
+
+  /**
+   * allocate the item list and items for given number of items at once
+   */
+  void reserve(size_t count) {
+    if (count > itemngram_vector.capacity()) {
+      itemngram_vector.reserve(count);
+    }
+    items.reserve(count);
+  }
+
+  /**
+   * get approximate number of bytes allocated by the tree
+   */
+  size_t getMemoryUsage() const {
+    return nodes.getMemoryUsage() + items.getMemoryUsage() +
+           itemngram_vector.capacity() * sizeof(TstItem<Object> *) + keyBytes;
+  }
 
   /**
    * Clean up the tree, nodes and stored values will all released
@@ -306,28 +372,22 @@ public:
 
   void clear() {
 #ifdef TST_INFO_ENABLE
-    nodeCount = 0;
-#endif
-    // clean up the tree
-    cleanup(root);
-    // clean up key, value ngram_vectors and reset variables.
-    /*keyngram_vector.clear();
-    valuengram_vector.clear();
-    */
-    /* release memory of items */
-    for (int i = 0; i < itemCount; i++) {
-      delete itemngram_vector[i];
-    }
-    itemngram_vector.clear();
-    root = NULL;
-    itemCount = 0;
-    existingItemIndex = -1;
-#ifdef TST_INFO_ENABLE
+    int nodeCount = (int)nodes.count() - 1;
     fprintf(stderr,
             "total %d node in the TST tree, node size %d, total %d bytes.\n",
-            nodeCount, 13, nodeCount * 13);
+            nodeCount, (int)sizeof(TstNode),
+            nodeCount * (int)sizeof(TstNode));
     fprintf(stderr, "total %d bytes for strings.\n", strLenCount);
 #endif
+    // release nodes and items a block at a time
+    nodes.clear();
+    nodes.add((char)0); // node 0 stands for no node
+    items.clear();
+    itemngram_vector.clear();
+    root = 0;
+    itemCount = 0;
+    keyBytes = 0;
+    existingItemIndex = -1;
   }
 
 private:
@@ -338,32 +398,21 @@ private:
    * @return the leaf node of the key( node with splitChar == 0 )
    */
 
-  TstNode *add(const char *key);
-#ifdef TST_INFO_ENABLE
-  int nodeCount, strLenCount;
-#endif
+  TstTree add(const char *key);
 
   /**
-   * clean up nodes in the tree. inline to improve performance
-   *
-   * @param p	root of the tree
+   * find the link holding the leaf node ( splitChar == 0 ) below a cursor
    */
-
-  void cleanup(TstTree p) {
-    if (p) {
-#ifdef TST_INFO_ENABLE
-      ++nodeCount;
-#endif
-      cleanup(p->left);
-
-      if (p->splitChar) {
-        cleanup(p->mid);
-      }
-
-      cleanup(p->right);
-      delete (p);
+  Cursor findEnd(Cursor cursor) {
+    TstTree p;
+    while ((p = *cursor) && nodes[p].splitChar) {
+      cursor = 0 < nodes[p].splitChar ? &nodes[p].left : &nodes[p].right;
     }
+    return cursor;
   }
+#ifdef TST_INFO_ENABLE
+  int strLenCount;
+#endif
 
   /**
    * Recursively search a pattern
@@ -399,14 +448,14 @@ private:
    * @param	itemngram_vector - ngram_vectors that holds all item which is
    * pair of key & value
    * @param	start - start position of the ngram_vector
-   * @param	end - end position of the ngram_vector
+   * @param	end - position after the last item of the ngram_vector
    * Note: current TST tree will be cleared before build balanced tree.
    *
    */
 
   void
   buildBalancedTreeRecursive(ngram_vector<TstItem<Object>> &itemngram_vector,
-                             int start, int end);
+                             size_t start, size_t end);
 
   /**
    * Return a list of items sorted by key, by travering the tree recursively
@@ -423,34 +472,41 @@ private:
   ngram_vector<TstItem<Object> *>
       itemngram_vector; /* ngram_vector to track of inserted items */
 
-  ngram_vector<int>
+  ngram_vector<size_t>
       *sortedItemIndexngram_vectorPtr; // pointer to the ngram_vector of sorted
                                        // items, used for recursive traverse
 
-  ngram_vector<int>
+  ngram_vector<size_t>
       *pmngram_vectorPtr; // pointer to the ngram_vector of partial matched
                           // items, used for recursive matching
 
-  ngram_vector<int>
+  ngram_vector<size_t>
       *nearngram_vectorPtr; // pointer to the ngram_vector of near neighbor
                             // items, used for recursive searching.
 
+  ngram_arena<TstNode> nodes;          // all nodes, node 0 is unused
+  ngram_arena<TstItem<Object>> items; // all items, in itemngram_vector order
+
   TstTree root;
 
-  int itemCount; // total number of items in the tree
+  size_t itemCount; // total number of items in the tree
 
-  int existingItemIndex; // when inserting, if item already existed, it will be
-                         // set the index of the existing item. If no existed,
-                         // set to -1
+  size_t keyBytes; // bytes of the item keys
+
+  ptrdiff_t existingItemIndex; // when inserting, if item already existed, it
+                               // will be set the index of the existing item.
+                               // If no existed, set to -1
 };
 
 template <class Object>
 TernarySearchTree<Object>::TernarySearchTree()
     : sortedItemIndexngram_vectorPtr(0), pmngram_vectorPtr(0),
-      nearngram_vectorPtr(0), root(0), itemCount(0), existingItemIndex(-1) {
+      nearngram_vectorPtr(0), root(0), itemCount(0), keyBytes(0),
+      existingItemIndex(-1) {
 #ifdef TST_INFO_ENABLE
   strLenCount = 0;
 #endif
+  nodes.add((char)0); // node 0 stands for no node
 }
 template <class Object> TernarySearchTree<Object>::~TernarySearchTree() {
   this->clear();
@@ -461,22 +517,25 @@ TstNode *TernarySearchTree<Object>::add(const char *key, const Object &value) {
 #ifdef TST_INFO_ENABLE
   strLenCount += sizeof(string(key)) + (int)strlen(key) + 1;
 #endif
-  TstNode *p = add(key);
-  if (p) {
-    if (this->existingItemIndex == -1) { // key not existed in tst tree
-      this->itemngram_vector.add(new TstItem<Object>(key, value));
-      p->index = itemCount - 1;
-    } else {
-      // if key alreay existed in the tree, replace its value with new value
-      itemngram_vector[this->existingItemIndex]->value = value;
-      p->index = this->existingItemIndex;
-    }
+  TstTree p = add(key);
+  if (!p) {
+    return NULL;
   }
-  return p;
+  TstNode *node = &nodes[p];
+  if (this->existingItemIndex == -1) { // key not existed in tst tree
+    this->itemngram_vector.add(&items[items.add(key, value)]);
+    node->index = (uint32_t)(itemCount - 1);
+    keyBytes += strlen(key) + 1;
+  } else {
+    // if key alreay existed in the tree, replace its value with new value
+    itemngram_vector[this->existingItemIndex]->value = value;
+    node->index = this->existingItemIndex;
+  }
+  return node;
 }
 
 template <class Object>
-TstNode *TernarySearchTree<Object>::add(const char *key) {
+TstTree TernarySearchTree<Object>::add(const char *key) {
   // cout<<"Inserting "<<key<<endl;
   TstTree p = this->root;
   TstTree parent = 0;
@@ -485,52 +544,39 @@ TstNode *TernarySearchTree<Object>::add(const char *key) {
 
   while (p) {
     parent = p;
-    if (*key < p->splitChar) {
-      p = p->left;
-    } else if (*key == p->splitChar) {
+    if (*key < nodes[p].splitChar) {
+      p = nodes[p].left;
+    } else if (*key == nodes[p].splitChar) {
       // return true, if the current character is the end-of-string character 0
       if (*key == 0) {
-        this->existingItemIndex = p->index;
+        this->existingItemIndex = nodes[p].index;
         break;
       }
-      p = p->mid;
+      p = nodes[p].mid;
       ++key;
     } else {
-      p = p->right;
+      p = nodes[p].right;
     }
   }
 
   if (!p) // key not found
   {
     this->existingItemIndex = -1;
-    p = new TstNode(*key);
-    // cout<<"char "<<p->splitChar<<endl;
+    p = nodes.add(*key);
     if (parent) {
-
-      /*if ( *key == parent->splitChar )
-      {
-              parent->mid = p;
-      }
-      else if ( *key < parent->splitChar )
-      {
-              parent->left = p;
-      }
-      else
-      {
-              parent->right = p;
-      }
-      */
-      int diff = *key - parent->splitChar;
-      diff == 0 ? parent->mid = p
-                : diff < 0 ? parent->left = p : parent->right = p;
+      TstNode &parentNode = nodes[parent];
+      int diff = *key - parentNode.splitChar;
+      diff == 0 ? parentNode.mid = p
+                : diff < 0 ? parentNode.left = p : parentNode.right = p;
     }
     if (!root) {
       root = p;
     }
-    while (p->splitChar) {
+    while (nodes[p].splitChar) {
       ++key;
-      p->mid = new TstNode(*key);
-      p = p->mid; // move to new node
+      TstTree child = nodes.add(*key);
+      nodes[p].mid = child;
+      p = child; // move to new node
     }
 
     ++itemCount;
@@ -539,14 +585,49 @@ TstNode *TernarySearchTree<Object>::add(const char *key) {
   return p;
 }
 
+template <class Object>
+typename TernarySearchTree<Object>::Cursor
+TernarySearchTree<Object>::advance(Cursor cursor, const char *key,
+                                   size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    char c = key[i];
+    TstTree p;
+    while ((p = *cursor) && nodes[p].splitChar != c) {
+      cursor = c < nodes[p].splitChar ? &nodes[p].left : &nodes[p].right;
+    }
+    if (!p) {
+      p = *cursor = nodes.add(c);
+    }
+    cursor = &nodes[p].mid;
+  }
+  return cursor;
+}
+
+template <class Object>
+TstNode *TernarySearchTree<Object>::add(Cursor cursor, const char *key,
+                                        size_t length, const Object &value) {
+  cursor = findEnd(cursor);
+  TstTree p = *cursor;
+  if (p) {
+    // key already existed in the tree, replace its value with new value
+    itemngram_vector[nodes[p].index]->value = value;
+  } else {
+    p = *cursor = nodes.add((char)0);
+    this->itemngram_vector.add(&items[items.add(key, length, value)]);
+    nodes[p].index = (uint32_t)itemCount++;
+    keyBytes += length + 1;
+  }
+  return &nodes[p];
+}
+
 template <class Object>
 bool TernarySearchTree<Object>::contains(const char *key) {
   return getItemIndex(key) != -1;
 }
 
 template <class Object>
-ngram_vector<int> TernarySearchTree<Object>::getSortedItemIndexes() {
-  ngram_vector<int> sortedItemIndexngram_vector;
+ngram_vector<size_t> TernarySearchTree<Object>::getSortedItemIndexes() {
+  ngram_vector<size_t> sortedItemIndexngram_vector;
   this->sortedItemIndexngram_vectorPtr = &sortedItemIndexngram_vector;
   this->getSortedItemIndexes(this->root);
   return sortedItemIndexngram_vector;
@@ -555,20 +636,21 @@ ngram_vector<int> TernarySearchTree<Object>::getSortedItemIndexes() {
 template <class Object>
 void TernarySearchTree<Object>::getSortedItemIndexes(TstTree p) {
   if (p) {
-    getSortedItemIndexes(p->left);
-    if (p->splitChar) {
-      getSortedItemIndexes(p->mid);
+    const TstNode &node = nodes[p];
+    getSortedItemIndexes(node.left);
+    if (node.splitChar) {
+      getSortedItemIndexes(node.mid);
     } else {
-      sortedItemIndexngram_vectorPtr->add(p->index);
+      sortedItemIndexngram_vectorPtr->add(node.index);
     }
-    getSortedItemIndexes(p->right);
+    getSortedItemIndexes(node.right);
   }
 }
 
 template <class Object>
-ngram_vector<int>
+ngram_vector<size_t>
 TernarySearchTree<Object>::partialMatchSearch(const char *key) {
-  ngram_vector<int> pmngram_vector;
+  ngram_vector<size_t> pmngram_vector;
   pmngram_vectorPtr = &pmngram_vector;
   partialMatchSearch(root, (char *)key);
   return pmngram_vector;
@@ -579,27 +661,28 @@ void TernarySearchTree<Object>::partialMatchSearch(TstTree tree,
                                                    const char *key) {
   if (!tree)
     return;
+  const TstNode &node = nodes[tree];
 
   // partial match left
-  if (*key == '?' || *key == '*' || *key < tree->splitChar) {
-    partialMatchSearch(tree->left, key);
+  if (*key == '?' || *key == '*' || *key < node.splitChar) {
+    partialMatchSearch(node.left, key);
   }
   // partial match middle
-  if (*key == '?' || *key == '*' || *key == tree->splitChar) {
-    if (tree->splitChar && *key) {
+  if (*key == '?' || *key == '*' || *key == node.splitChar) {
+    if (node.splitChar && *key) {
       if (*key == '*') {
-        partialMatchSearch(tree->mid, key);
+        partialMatchSearch(node.mid, key);
       } else {
-        partialMatchSearch(tree->mid, key + 1); // search next pattern char
+        partialMatchSearch(node.mid, key + 1); // search next pattern char
       }
     }
   }
-  if ((*key == 0 || *key == '*') && tree->splitChar == 0) {
-    pmngram_vectorPtr->add(tree->index);
+  if ((*key == 0 || *key == '*') && node.splitChar == 0) {
+    pmngram_vectorPtr->add(node.index);
   }
 
-  if (*key == '?' || *key == '*' || *key > tree->splitChar) {
-    partialMatchSearch(tree->right, key);
+  if (*key == '?' || *key == '*' || *key > node.splitChar) {
+    partialMatchSearch(node.right, key);
   }
 }
 
@@ -609,51 +692,51 @@ void TernarySearchTree<Object>::nearSearch(TstTree tree, const char *key,
   if (!tree || distance < 0) {
     return;
   }
+  const TstNode &node = nodes[tree];
 
-  if (distance > 0 || *key < tree->splitChar) {
-    nearSearch(tree->left, key, distance);
+  if (distance > 0 || *key < node.splitChar) {
+    nearSearch(node.left, key, distance);
   }
 
-  if (tree->splitChar == 0) {
+  if (node.splitChar == 0) {
     if ((int)strlen(key) <= distance) {
       nearngram_vectorPtr->add(
-          tree->index); // found the matched key, added it to index ngram_vector
+          node.index); // found the matched key, added it to index ngram_vector
     }
   } else {
-    nearSearch(tree->mid, *key ? key + 1 : key,
-               (*key == tree->splitChar) ? distance : distance - 1);
+    nearSearch(node.mid, *key ? key + 1 : key,
+               (*key == node.splitChar) ? distance : distance - 1);
   }
 
-  if (distance > 0 || *key > tree->splitChar) {
-    nearSearch(tree->right, key, distance);
+  if (distance > 0 || *key > node.splitChar) {
+    nearSearch(node.right, key, distance);
   }
 }
 template <class Object>
 void TernarySearchTree<Object>::buildBalancedTree(
     ngram_vector<TstItem<Object>> &itemngram_vector) {
-  int count = (int)itemngram_vector.count();
+  size_t count = itemngram_vector.count();
 
-  if (count == itemngram_vector.count() && count > 0) {
+  if (count > 0) {
     this->clear();
     // sort the items by keys, and binary insert, then we will get a balanced
     // tree
     itemngram_vector.sort();
-    buildBalancedTreeRecursive(itemngram_vector, 0, count - 1);
+    buildBalancedTreeRecursive(itemngram_vector, 0, count);
   }
 }
 
 template <class Object>
 void TernarySearchTree<Object>::buildBalancedTreeRecursive(
-    ngram_vector<TstItem<Object>> &itemngram_vector, int start, int end) {
-  int mid;
-  if (start > end || end < 0) {
+    ngram_vector<TstItem<Object>> &itemngram_vector, size_t start,
+    size_t end) {
+  if (start >= end) {
     return;
   }
-  mid = (end - start + 1) / 2;
-  add(itemngram_vector[start + mid].key.c_str(),
-      itemngram_vector[start + mid].value);
-  buildBalancedTreeRecursive(itemngram_vector, start, start + mid - 1);
-  buildBalancedTreeRecursive(itemngram_vector, start + mid + 1, end);
+  size_t mid = start + (end - start) / 2;
+  add(itemngram_vector[mid].key.c_str(), itemngram_vector[mid].value);
+  buildBalancedTreeRecursive(itemngram_vector, start, mid);
+  buildBalancedTreeRecursive(itemngram_vector, mid + 1, end);
 }
 
 #endif
@@ -48,7 +48,11 @@ public:
     outFileName = "";
   }
 
-  ~Text2wfreq() {}
+  ~Text2wfreq() {
+    for (size_t i = 0; i < inFileNames.count(); i++) {
+      free(inFileNames[i]);
+    }
+  }
 
   /**
    * get options
@@ -74,11 +78,27 @@ public:
 
   string getOutFileName() { return outFileName; }
 
+  /**
+   * get the input files of --in, one empty name for stdin
+   */
+  const ngram_vector<char *> &getInFileNames() { return inFileNames; }
+
+  const NgramOptions &getNgramOptions() { return ngramOptions; }
+
 private:
-  int ngramN;         // default number of ngrams
-  int ngramType;      // default type
-  string inFileName;  // input text file name
-  string outFileName; // output text file name
+  int ngramN;                // default number of ngrams
+  int ngramType;             // default type
+  string inFileName;         // input text file name
+  string outFileName;        // output text file name
+  NgramOptions ngramOptions; // options for counting
+  ngram_vector<char *> inFileNames; // input files, allocated with strdup
+
+  /**
+   * add the input files named by an item of --in: a file, a glob pattern,
+   * or @list for a file listing one file name per line
+   * @return	false if a list file can not be read
+   */
+  bool addInFiles(const char *item);
 };
 
 #endif
@@ -0,0 +1,74 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _TST_NGRAM_TABLE_H_
+#define _TST_NGRAM_TABLE_H_
+
+#include <ngram/ngram_table.h>
+#include <ngram/ternary_search_tree.h>
+
+/**
+ * ngram table stored in a ternary search tree, cursors are tree cursors.
+ *
+ * The tree ends keys with the null char, so keys are walked escaped: bytes
+ * 0 and 1 are walked as ESCAPE followed by the byte + 1. Items keep the
+ * original key.
+ */
+class TstNgramTable : public NgramTable {
+public:
+  Cursor getCursor() { return (Cursor)(uintptr_t)tree.getCursor(); }
+
+  Cursor advance(Cursor cursor, const char *key, size_t length);
+
+  NgramValue *add(Cursor cursor, const char *key, size_t length, int n,
+                  bool &added);
+
+  size_t count() const { return tree.count(); }
+
+  const char *getKey(size_t index, size_t &length) {
+    TstItem<NgramValue> *item = tree.getItem(index);
+    length = item->key.length();
+    return item->key.c_str();
+  }
+
+  NgramValue &getValue(size_t index) {
+    return tree.getItem(index)->value;
+  }
+
+  size_t getMemoryUsage() const { return tree.getMemoryUsage(); }
+
+  void reserve(size_t keyCount) { tree.reserve(keyCount); }
+
+private:
+  enum { ESCAPE = 1 };
+
+  TernarySearchTree<NgramValue> tree;
+
+  static TernarySearchTree<NgramValue>::Cursor toTreeCursor(Cursor cursor) {
+    return (TernarySearchTree<NgramValue>::Cursor)(uintptr_t)cursor;
+  }
+};
+
+#endif
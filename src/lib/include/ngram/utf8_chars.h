@@ -0,0 +1,79 @@
+/*******************************************************************
+C++ Package of  ngrams
+Copyright (C) 2006  Zheyuan Yu
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+Read full GPL at http://www.gnu.org/copyleft/gpl.html
+
+Email me at jerryy@gmail.com if you have any question or comment
+WebSite: http://www.cs.dal.ca/~zyu
+
+*************************************************************************/
+
+#ifndef _UTF8_CHARS_H_
+#define _UTF8_CHARS_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Helpers for reading the chars of UTF-8 text, along with utf8-cpp, which
+ * validates and decodes the sequences.
+ */
+class Utf8Chars {
+public:
+  enum { REPLACEMENT_CHAR = 0xFFFD }; // stands for each invalid byte
+
+  /**
+   * get the bytes of the sequence a byte starts, 1 for ASCII and for bytes
+   * that can not start a sequence
+   */
+  static int sequenceLength(unsigned char lead) {
+    if (lead < 0xC2 || lead > 0xF4) {
+      return 1;
+    }
+    return lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+  }
+
+  /**
+   * true for the bytes continuing a sequence
+   */
+  static bool isContinuation(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+  /**
+   * skip ASCII bytes, 16 at a time when the build targets SSE2
+   * @return	the first byte from p that is not ASCII, or end
+   */
+  static const char *skipAscii(const char *p, const char *end);
+
+  /**
+   * map a code point to upper case, as toupper does for ASCII. Only the one
+   * to one mappings of the Unicode data are applied, so that upper and lower
+   * case chars are counted as one, a char such as U+00DF whose upper case is
+   * two chars is kept.
+   */
+  static uint32_t toUpper(uint32_t c) {
+    if (c < 0x80) {
+      return c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c;
+    }
+    return toUpperNonAscii(c);
+  }
+
+private:
+  static uint32_t toUpperNonAscii(uint32_t c);
+};
+
+#endif
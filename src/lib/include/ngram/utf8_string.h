@@ -31,6 +31,7 @@ WebSite: http://www.cs.dal.ca/~zyu
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <utility>
 
 using namespace std;
 
@@ -79,6 +80,16 @@ public:
    */
   utf8_string(const utf8_string &copy);
 
+  /**
+   * Move constructor, takes over the buffer of str and leaves it empty
+   */
+  utf8_string(utf8_string &&str)
+      : buffer(str.buffer), strLength(str.strLength),
+        bufferLength(str.bufferLength) {
+    str.buffer = NULL;
+    str.strLength = str.bufferLength = 0;
+  }
+
   /**
    * Destructor
    */
@@ -93,6 +104,14 @@ public:
   const utf8_string &operator=(const char *content);
   const utf8_string &operator=(const utf8_string &copy);
   const utf8_string &operator=(const char ch);
+  const utf8_string &operator=(utf8_string &&str) {
+    if (&str != this) {
+      std::swap(buffer, str.buffer);
+      std::swap(strLength, str.strLength);
+      std::swap(bufferLength, str.bufferLength);
+    }
+    return *this;
+  }
 
   bool operator==(const utf8_string &str) const {
     return this->strLength == str.strLength && compare(str.c_str()) == 0;
@@ -27,21 +27,22 @@ WebSite: http://www.cs.dal.ca/~zyu
 #define _WORD_NGRAMS_H_
 
 #include <ngram/ngrams.h>
+#include <ngram/ternary_search_tree.h>
+
+#include <mutex>
 /**
  * class for all word ngrams related operations
  *
+ * Each word is given a 32 bits id by the word table, a word ngram key is
+ * the ids of its words packed back to back, N * 4 bytes.
+ * Routed shards must all use the same ids, so they take them from the word
+ * table of their parent, under a lock, and cache them in their own.
+ *
  * Revisions:
  * Feb 18, 2006. Jerry Yu
  * Initial implementation
  */
 class WordNgrams : public Ngrams {
-  enum {
-    ENCODE_BASE = 254,            // base for converting word id
-    ENCODE_NULL = 0xFF,           // character for NULL
-    ENCODE_WORD_DELIMITER = 0xFE, // character for word seperator
-    WORD_DELIMITER = '\t'
-  };
-
 public:
   /**
    * Constructor
@@ -49,19 +50,14 @@ public:
   WordNgrams(int newNgramN, const char *newInFileName,
              const char *newOutFileName,
              const char *newDelimiters = Config::getDefaultDelimiters(),
-             const char *newStopChars = Config::getDefaultStopChars());
+             const char *newStopChars = Config::getDefaultStopChars(),
+             const NgramOptions &newOptions = NgramOptions());
 
   /**
    * Destructor
    */
   virtual ~WordNgrams();
 
-  /**
-   * readin whole text file and feed in all tokens.
-   */
-
-  void addTokens();
-
   /**
    * feed a token in, the token will be processed internally to generating ngram
    *
@@ -70,87 +66,105 @@ public:
 
   void addToken(const utf8_string &token);
 
+  /**
+   * same as addToken( const utf8_string & ), for a word of given length
+   */
+  void addToken(const char *token, size_t length);
+
+  /**
+   * feed in words already split by the caller, same as addToken for each
+   */
+  void feedTokens(const char *const *tokens, const size_t *lengths,
+                  size_t count);
+
+protected:
   /**
    * sort ngrams by frequency/ngram/or both, then output
    */
+  void outputText();
 
-  virtual void output();
+  int getType() const { return Config::WORD_NGRAM; }
 
-private:
-  TernarySearchTree<unsigned>
-      wordTable; // save all the unique words with a unique id
+  /**
+   * create an empty shard with the settings of parent
+   */
+  explicit WordNgrams(WordNgrams *parent);
+
+  void tokenize(const char *begin, const char *end);
+
+  void finishTokens();
+
+  Ngrams *createShard() { return new WordNgrams(this); }
 
-  // convert number base 10 to a number utf8_string in different base
-  // base: max to ENCODE_BASE, we need leave one ascii as end of utf8_string
-  // sign, one for word seperator
-  void encodeInteger(int num, int bas, char *buff);
+  /**
+   * a chunk starts after a delimiter or stop char
+   */
+  const char *findShardStart(const char *p, const char *end) const;
+
+  /**
+   * word ids of the shard are mapped to ids of this word table
+   */
+  void merge(Ngrams &shard);
 
-  // decode a number utf8_string in base x to an integer in base 10
-  // bas: max to ENCODE_BASE, we need leave one ascii as end of utf8_string sign
-  // and one for word seperator
-  int decodeInteger(unsigned char *buffer, int bas);
+  void decodeNgram(const char *key, size_t length, int n, utf8_string &ngram) {
+    decodeWordNgram(key, n, ngram);
+  }
 
   /**
-   * Generate ngrams when queue has NGRAM_N - 1 tokens.
-   * the token queue need to be processed specially for the first NGRAM_N - 1
-   * tokens
+   * the words are written sorted, so ids in the file are ranks
    */
-  void preParse(int count);
+  void writeVocabulary(NgramFileWriter &writer);
+
+  void encodeFileKey(const char *key, size_t length, int n,
+                     utf8_string &fileKey);
+
+  bool decodeFileKey(const NgramFileReader &reader, const char *fileKey,
+                     size_t length, int n, utf8_string &key);
 
   /**
-   * Once the queue is full, it will start to pop out ngrams
-   * for each new token pushing in
+   * file keys hold the ranks of the words rather than their ids
    */
+  bool reordersFileKeys() const { return true; }
 
-  void parse();
+  /**
+   * the words of a ngram are split at '_'. If the words contain '_' too, the
+   * split must be the only one into known words, as those of the 1-grams
+   * output first
+   */
+  bool encodeNgram(const char *ngram, size_t length, int n, utf8_string &key);
+
+private:
+  TernarySearchTree<unsigned>
+      wordTable; // save all the unique words with a unique id
+  utf8_string partialToken; // word continued from the previous input block
+  WordNgrams *parent;        // parent of a shard, NULL otherwise
+  std::mutex wordTableLock;  // guards the word table used by routed shards
+  uint32_t *fileIds; // ids in the binary ngram count file, by word id
 
   /**
    * add each word to the word table
    * the word table is used to generate unique id for each word
-   * that id will be further encoded to base 254 to make it more compact
-   * before being inserted into ternary search tree
-   */
-  unsigned AddToWordTable(const char *word);
-
-  /**
-   * output one id ngram (eg. 10_9_283 ) to word ngram ( eg. this_is_a )
-   */
-  /*void outputWordNgram( const utf8_string & ngram, int frequency, int n )
-  {
-  int index = 0;
-  int loop = 0;
-  const char * p = ngram.c_str();
-  unsigned char buff[32];
-  char delimiter = char(ENCODE_WORD_DELIMITER);
-  while ( loop++ < n )
-  {
-  while ( *p != delimiter && *p != '\0' )
-  {
-  buff[ index ++ ] = (unsigned char)*p++;
-  }
-  p++;
-  buff[ index ] = '\0';
-  index = 0;
-  //printf("ID -- %d.\n", decodeInteger( buff, ENCODE_BASE ) );
-  printf("%s%c", this->wordTable.getKey( decodeInteger( buff, ENCODE_BASE ) ),
-  loop < n ? '_' : '\t' );
-  }
-  printf( "%d\n", frequency );
-
-  }
-  */
+   * @return	id of the word
+   */
+  unsigned AddToWordTable(const char *word, size_t length);
 
   /**
-   * convert from id ( encoded ) into word ngram
+   * convert from packed word ids into word ngram ( eg. this_is_a )
    */
 
-  void decodeWordNgram(const utf8_string &ngram, int n,
-                       utf8_string &decodedNgram);
+  void decodeWordNgram(const char *ngram, int n, utf8_string &decodedNgram);
 
   /**
-   * get ngram list for given n
+   * find how a ngram of n words joined by '_' splits into known words
+   * @param	wordEnds - gets the end of each word, if there is one split
+   * @return	number of splits, counted up to 2
    */
+  int splitNgram(const char *ngram, const char *end, int n,
+                 const char **wordEnds);
 
-  void getNgrams(ngram_vector<NgramToken *> &ngramVector, int n);
+  /**
+   * true if the word is in the word table
+   */
+  bool isKnownWord(const char *word, size_t length);
 };
 #endif
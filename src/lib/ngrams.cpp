@@ -23,69 +23,1262 @@ WebSite: http://www.cs.dal.ca/~zyu
 
 *************************************************************************/
 
+#include <ngram/hash_ngram_table.h>
+#include <ngram/input_reader.h>
 #include <ngram/ngrams.h>
 
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <thread>
+
 Ngrams::Ngrams(int newNgramN, const char *newInFileName,
                const char *newOutFileName, const char *newDelimiters,
-               const char *newStopChars)
-    : ngramN(newNgramN), inFileName(newInFileName),
-      outFileName(newOutFileName) {
+               const char *newStopChars, const NgramOptions &newOptions)
+    : ngramN(newNgramN), inFileName(newInFileName ? newInFileName : ""),
+      outFileName(newOutFileName ? newOutFileName : ""), options(newOptions) {
+  ngramTable =
+      NgramTable::create(newOptions.tableType, newOptions.partitions);
   // initial queue
-  head = tail = 0;
+  windowLength = 0;
+  windowSize = 4096;
+  window = (char *)malloc(windowSize);
+  window[0] = 0;
+  tokenOffsets = new size_t[ngramN];
+  keyCursors = new NgramTable::Cursor[ngramN];
+  queueHead = 0;
   tokenCount = 0;
+  tokenSeparator = 0;
+  overflowing = false;
+  overflowTokens = 0;
+  router = NULL;
+  producer = 0;
+  prunedCount = 0;
+  directN = 0;
+  directCounts = NULL;
+  directTokens = 0;
+  sketch = NULL;
+  heavyHitters = NULL;
+  if (options.approximation == Config::COUNT_MIN_SKETCH) {
+    sketch = new CountMinSketch(options.sketchWidth, options.sketchDepth);
+    heavyHitters = new SpaceSaving *[ngramN];
+    for (int i = 0; i < ngramN; i++) {
+      heavyHitters[i] = new SpaceSaving(options.heavyHitters);
+    }
+  }
+  uniqueSketches = NULL;
+  if (options.approximation == Config::HYPER_LOG_LOG) {
+    this->enableUniqueSketches(options.uniquesPrecision);
+  }
+  pruneCheckTokens = 0;
   this->setDelimiters(newDelimiters);
   this->setStopChars(newStopChars);
-  totals = new int[ngramN];
-  uniques = new int[ngramN];
-  memset(totals, 0, ngramN * sizeof(int));
-  memset(uniques, 0, ngramN * sizeof(int));
+  totals = new int64_t[ngramN];
+  uniques = new int64_t[ngramN];
+  memset(totals, 0, ngramN * sizeof(int64_t));
+  memset(uniques, 0, ngramN * sizeof(int64_t));
+}
+
+void Ngrams::addTokens() {
+  const char *fileName = inFileName.c_str();
+  this->addFiles(&fileName, 1);
+}
+
+void Ngrams::addFiles(const char *const *fileNames, int fileCount) {
+  if (options.sampleUniques && this->isSizable()) {
+    this->reserve(this->sampleUniques(fileNames, fileCount));
+  } else {
+    this->reserve(options.expectedUniques);
+  }
+  bool parallel = options.threads > 1 && !options.memoryLimit && !sketch;
+  if (parallel && fileCount > 1) {
+    this->addFilesInParallel(fileNames, fileCount);
+    this->endInput();
+    return;
+  }
+  for (int i = 0; i < fileCount; i++) {
+    InputReader reader;
+    if (!reader.open(fileNames[i])) {
+      printf("Ngrams:addTokens - failed to open file %s\n", fileNames[i]);
+      continue;
+    }
+    const char *begin;
+    const char *end;
+    if (parallel && reader.isMapped()) {
+      if (reader.read(begin, end)) {
+        this->addTokensInParallel(begin, end);
+      }
+      break;
+    }
+    while (reader.read(begin, end)) {
+      this->tokenize(begin, end);
+    }
+    this->endFile();
+  }
+  this->endInput();
+}
+
+void Ngrams::feed(const char *data, size_t length) {
+  this->tokenize(data, data + length);
+}
+
+void Ngrams::feedTokens(const char *const *tokens, const size_t *lengths,
+                        size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    this->addToken(tokens[i], lengths[i]);
+  }
+}
+
+void Ngrams::finish() {
+  this->endFile();
+  this->endInput();
+}
+
+void Ngrams::endFile() {
+  this->finishTokens();
+  if (options.documentBoundaries) {
+    queueHead = 0;
+    tokenCount = 0;
+    windowLength = 0;
+    window[0] = 0;
+  }
+}
+
+void Ngrams::endInput() {
+  this->flushDirectCounts();
+  if (runs.count() > 0 || mergedRuns.count() > 0) {
+    this->mergeRuns();
+  }
+  if (sketch) {
+    this->collectHeavyHitters();
+  }
+  for (int i = 0; uniqueSketches && i < ngramN; i++) {
+    uniques[i] = uniqueSketches[i]->estimate();
+  }
+}
+
+void Ngrams::addApproximateNgram(const char *ngram, size_t length, int n,
+                                 int64_t frequency) {
+  uint64_t hash = HashNgramTable::hash(ngram, length);
+  if (uniqueSketches) {
+    uniqueSketches[n - 1]->add(hash);
+  } else {
+    sketch->add(hash, frequency);
+    heavyHitters[n - 1]->add(ngram, length, hash, frequency);
+  }
+  totals[n - 1] += frequency;
+}
+
+void Ngrams::reserve(size_t expectedUniques) {
+  if (expectedUniques > 0 && this->isSizable()) {
+    ngramTable->reserve(expectedUniques);
+  }
+}
+
+void Ngrams::enableUniqueSketches(int precision) {
+  uniqueSketches = new HyperLogLog *[ngramN];
+  for (int i = 0; i < ngramN; i++) {
+    uniqueSketches[i] = new HyperLogLog(precision);
+  }
+}
+
+size_t Ngrams::sampleUniques(const char *const *fileNames, int fileCount) {
+  long long *sizes = new long long[fileCount];
+  long long inputSize = 0;
+  for (int i = 0; i < fileCount; i++) {
+    struct stat st;
+    if (stat(fileNames[i], &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG) {
+      delete[] sizes;
+      return 0;
+    }
+    sizes[i] = (long long)st.st_size;
+    inputSize += sizes[i];
+  }
+
+  // the sample is slices spread evenly over the input, the even slices are
+  // counted apart from the odd ones to see how the uniques grow
+  const long long sliceBytes = UNIQUES_SAMPLE_BYTES / UNIQUES_SAMPLE_SLICES;
+  long long stride = std::max(inputSize / UNIQUES_SAMPLE_SLICES, sliceBytes);
+  Ngrams *samples[2];
+  long long sampleBytes[2] = {0, 0};
+  for (int i = 0; i < 2; i++) {
+    samples[i] = this->createShard();
+    samples[i]->enableUniqueSketches(HyperLogLog::MAX_PRECISION);
+  }
+  int slice = 0;
+  long long fileStart = 0;
+  for (int i = 0; i < fileCount && slice < UNIQUES_SAMPLE_SLICES; i++) {
+    InputReader reader;
+    const char *begin;
+    const char *end;
+    long long position = fileStart; // input offset of the block read
+    fileStart += sizes[i];
+    if (!reader.open(fileNames[i])) {
+      continue;
+    }
+    while (slice < UNIQUES_SAMPLE_SLICES && reader.read(begin, end)) {
+      long long blockEnd = position + (end - begin);
+      while (slice < UNIQUES_SAMPLE_SLICES && slice * stride < blockEnd) {
+        Ngrams *sample = samples[slice % 2];
+        long long from = std::max(slice * stride, position);
+        long long to = std::min(slice * stride + sliceBytes, blockEnd);
+        if (from < to) {
+          sample->tokenize(begin + (from - position), begin + (to - position));
+          sampleBytes[slice % 2] += to - from;
+        }
+        if (to == blockEnd && to < slice * stride + sliceBytes) {
+          break; // the slice goes on in the next block
+        }
+        sample->finishTokens();
+        ++slice;
+      }
+      position = blockEnd;
+    }
+  }
+  for (int i = 0; i < 2; i++) {
+    samples[i]->finishTokens();
+    samples[i]->flushDirectCounts();
+  }
+
+  double expected = 0;
+  long long halfBytes = sampleBytes[0];
+  long long allBytes = sampleBytes[0] + sampleBytes[1];
+  for (int n = 0; n < ngramN; n++) {
+    double halfUniques = (double)samples[0]->uniqueSketches[n]->estimate();
+    samples[0]->uniqueSketches[n]->merge(*samples[1]->uniqueSketches[n]);
+    double uniques = (double)samples[0]->uniqueSketches[n]->estimate();
+    if (inputSize > allBytes && halfBytes > 0 && allBytes > halfBytes &&
+        uniques > halfUniques) {
+      // by Heaps' law the uniques grow as a power of the input size, whose
+      // exponent is how much they grew from the even slices to all of them
+      double exponent = std::min(
+          log(uniques / halfUniques) / log((double)allBytes / halfBytes), 1.0);
+      uniques *= pow((double)inputSize / allBytes, exponent);
+    }
+    expected += uniques;
+  }
+  delete samples[0];
+  delete samples[1];
+  delete[] sizes;
+  // a little room, as a table sized just too small grows to twice the size
+  return (size_t)(expected + expected / 8);
+}
+
+void Ngrams::mergeUniques(const Ngrams &shard) {
+  for (int i = 0; i < ngramN; i++) {
+    uniqueSketches[i]->merge(*shard.uniqueSketches[i]);
+    totals[i] += shard.totals[i];
+  }
+}
+
+void Ngrams::collectHeavyHitters() {
+  // the table is rebuilt, so that a heavy hitter taken over since an earlier
+  // call is gone
+  delete ngramTable;
+  ngramTable = NgramTable::create(options.tableType, options.partitions);
+  for (int n = 1; n <= ngramN; n++) {
+    SpaceSaving *hitters = heavyHitters[n - 1];
+    for (size_t i = 0; i < hitters->count(); i++) {
+      size_t length;
+      const char *key = hitters->getKey(i, length);
+      bool added;
+      // both estimates are never too low
+      ngramTable->add(key, length, n, added)->frequency =
+          std::min(hitters->getCount(i), sketch->estimate(hitters->getHash(i)));
+    }
+    uniques[n - 1] = (int64_t)hitters->count();
+  }
+}
+
+int64_t Ngrams::getMissingCount() const {
+  int64_t missing = 0;
+  for (int i = 0; sketch && i < ngramN; i++) {
+    missing = std::max(missing, heavyHitters[i]->getMinCount());
+  }
+  return missing;
+}
+
+void Ngrams::writeApproximation(OutputWriter &out) {
+  if (sketch) {
+    out.format("Counts are approximate, frequencies may be up to %" PRId64
+               " too high with probability %.4f, ngrams seen up to %" PRId64
+               " times may be left out.\n",
+               this->getErrorBound(), this->getConfidence(),
+               this->getMissingCount());
+  }
+  if (uniqueSketches) {
+    out.format("Unique ngrams are estimated, with a standard error of %.2f%%, "
+               "no ngrams are kept.\n",
+               this->getUniquesError() * 100);
+  }
+}
+
+void Ngrams::addTokensInParallel(const char *begin, const char *end) {
+  int shardCount = options.threads;
+  ShardInput *inputs = new ShardInput[shardCount];
+  const char *chunkStart = begin;
+  for (int i = 0; i < shardCount; i++) {
+    const char *p = begin + (size_t)(end - begin) / shardCount * (i + 1);
+    const char *chunkEnd = end;
+    if (i < shardCount - 1) {
+      // a chunk may end where it starts
+      chunkEnd = p <= chunkStart ? chunkStart : this->findShardStart(p, end);
+    }
+    ShardInput input = {chunkStart, chunkEnd, end, NULL, 0, 0, 0};
+    inputs[i] = input;
+    chunkStart = chunkEnd;
+  }
+  this->countInParallel(inputs, shardCount);
+  delete[] inputs;
+}
+
+void Ngrams::addFilesInParallel(const char *const *fileNames, int fileCount) {
+  // the shards get ranges of files of about the same number of bytes
+  long long *sizes = new long long[fileCount];
+  long long totalSize = 0;
+  for (int i = 0; i < fileCount; i++) {
+    struct stat st;
+    sizes[i] = stat(fileNames[i], &st) == 0 ? (long long)st.st_size : 0;
+    totalSize += sizes[i];
+  }
+  int shardCount = options.threads;
+  ShardInput *inputs = new ShardInput[shardCount];
+  int file = 0;
+  long long size = 0;
+  for (int i = 0; i < shardCount; i++) {
+    int firstFile = file;
+    long long shardEnd = totalSize / shardCount * (i + 1);
+    while (file < fileCount && (i == shardCount - 1 || size < shardEnd)) {
+      size += sizes[file++];
+    }
+    ShardInput input = {NULL, NULL, NULL, fileNames, firstFile, file,
+                        fileCount};
+    inputs[i] = input;
+  }
+  this->countInParallel(inputs, shardCount);
+  delete[] inputs;
+  delete[] sizes;
+}
+
+void Ngrams::countInParallel(const ShardInput *inputs, int shardCount) {
+  // the partition owners do not prune, pruning shards are merged instead
+  if (options.partitions > 1 && !uniqueSketches && !options.maxMemory) {
+    this->countInPartitions(inputs, shardCount);
+    return;
+  }
+
+  // this counts the first input, shards the others
+  Ngrams **shards = new Ngrams *[shardCount];
+  std::thread *threads = new std::thread[shardCount];
+  for (int i = 1; i < shardCount; i++) {
+    shards[i] = this->createShard();
+    threads[i] = std::thread(&Ngrams::countShard, shards[i], &inputs[i]);
+  }
+  this->countShard(&inputs[0]);
+
+  for (int i = 1; i < shardCount; i++) {
+    threads[i].join();
+    if (uniqueSketches) {
+      this->mergeUniques(*shards[i]);
+    } else {
+      this->mergeShard(*shards[i]);
+    }
+    delete shards[i];
+  }
+  delete[] threads;
+  delete[] shards;
+}
+
+void Ngrams::countInPartitions(const ShardInput *inputs, int shardCount) {
+  PartitionedNgramTable *table =
+      static_cast<PartitionedNgramTable *>(ngramTable);
+  int partitionCount = table->getPartitionCount();
+  NgramRouter partitionRouter(shardCount, table, ngramN);
+
+  std::thread *owners = new std::thread[partitionCount];
+  for (int i = 0; i < partitionCount; i++) {
+    owners[i] = std::thread(&NgramRouter::aggregate, &partitionRouter, i);
+  }
+  Ngrams **shards = new Ngrams *[shardCount];
+  std::thread *threads = new std::thread[shardCount];
+  for (int i = 0; i < shardCount; i++) {
+    shards[i] = this->createShard();
+    shards[i]->router = &partitionRouter;
+    shards[i]->producer = i;
+    threads[i] = std::thread(&Ngrams::countShard, shards[i], &inputs[i]);
+  }
+
+  for (int i = 0; i < shardCount; i++) {
+    threads[i].join();
+    for (int n = 0; n < ngramN; n++) {
+      totals[n] += shards[i]->totals[n];
+    }
+    delete shards[i];
+  }
+  for (int i = 0; i < partitionCount; i++) {
+    owners[i].join();
+    for (int n = 1; n <= ngramN; n++) {
+      uniques[n - 1] += partitionRouter.count(i, n);
+    }
+  }
+  delete[] threads;
+  delete[] shards;
+  delete[] owners;
+}
+
+void Ngrams::countShard(const ShardInput *input) {
+  if (input->fileNames) {
+    this->countFiles(input->fileNames, input->firstFile, input->lastFile,
+                     input->fileCount);
+  } else {
+    this->countChunk(input->begin, input->chunkEnd, input->end);
+  }
+  overflowing = false;
+  overflowTokens = 0;
+  this->flushDirectCounts();
+
+  if (router) {
+    router->finish(producer);
+  }
+}
+
+void Ngrams::countChunk(const char *begin, const char *chunkEnd,
+                        const char *end) {
+  this->tokenize(begin, chunkEnd);
+  overflowing = chunkEnd < end;
+  if (this->tokenizeOverflow(chunkEnd, end) == end) {
+    this->finishTokens();
+  }
+}
+
+void Ngrams::countFiles(const char *const *fileNames, int firstFile,
+                        int lastFile, int fileCount) {
+  for (int i = firstFile; i < lastFile; i++) {
+    InputReader reader;
+    if (!reader.open(fileNames[i])) {
+      printf("Ngrams:addTokens - failed to open file %s\n", fileNames[i]);
+      continue;
+    }
+    const char *begin;
+    const char *end;
+    while (reader.read(begin, end)) {
+      this->tokenize(begin, end);
+    }
+    this->endFile();
+  }
+  if (firstFile == lastFile || options.documentBoundaries) {
+    return;
+  }
+
+  // the ngrams starting in the last file may end in the next ones
+  overflowing = true;
+  for (int i = lastFile; i < fileCount && overflowTokens < ngramN - 1; i++) {
+    InputReader reader;
+    if (!reader.open(fileNames[i])) {
+      continue;
+    }
+    const char *begin;
+    const char *end;
+    while (overflowTokens < ngramN - 1 && reader.read(begin, end)) {
+      this->tokenizeOverflow(begin, end);
+    }
+    this->finishTokens();
+  }
+}
+
+const char *Ngrams::tokenizeOverflow(const char *begin, const char *end) {
+  // feed the overflow tokens in small blocks, to stop soon after them
+  const size_t OVERFLOW_BLOCK = 64;
+  while (begin < end && overflowTokens < ngramN - 1) {
+    const char *blockEnd =
+        (size_t)(end - begin) > OVERFLOW_BLOCK ? begin + OVERFLOW_BLOCK : end;
+    this->tokenize(begin, blockEnd);
+    begin = blockEnd;
+  }
+  return begin;
+}
+
+void Ngrams::merge(Ngrams &shard) {
+  size_t count = shard.ngramTable->count();
+  for (size_t i = 0; i < count; i++) {
+    NgramValue &value = shard.ngramTable->getValue(i);
+    size_t length;
+    const char *key = shard.ngramTable->getKey(i, length);
+    this->addNgram(key, length, value.n, value.frequency);
+  }
+}
+
+void Ngrams::mergeShard(Ngrams &shard) {
+  // merge adds the frequencies of the ngrams left in the shard's table
+  int64_t *counted = new int64_t[ngramN];
+  memcpy(counted, totals, ngramN * sizeof(int64_t));
+  this->merge(shard);
+  for (int i = 0; i < ngramN; i++) {
+    totals[i] = counted[i] + shard.totals[i];
+  }
+  delete[] counted;
+  prunedCount += shard.prunedCount;
 }
 
 void Ngrams::addToken(const utf8_string &token) {
-  int count = this->pushQueue(token.c_str());
+  this->addToken(token.c_str(), token.length());
+}
 
-  if (count == this->ngramN) {
-    this->parse();
+void Ngrams::addToken(const char *token, size_t length) {
+  if (overflowing) {
+    if (overflowTokens == ngramN - 1) {
+      return;
+    }
+    ++overflowTokens;
+  }
+  if (this->tokenCount == this->ngramN) {
     this->popQueue();
-  } else if (count == this->ngramN - 1) {
-    this->preParse(count);
+  }
+  this->pushQueue(token, length);
+  this->parse();
+
+  // the table size is checked once in a while
+  size_t budget = options.memoryLimit ? options.memoryLimit : options.maxMemory;
+  if (budget && (++pruneCheckTokens & 0xFFFF) == 0 &&
+      ngramTable->getMemoryUsage() > budget) {
+    if (options.memoryLimit) {
+      this->spill();
+    } else {
+      this->prune();
+    }
   }
 }
 
-void Ngrams::addNgram(const char *ngram, int n) {
-  assert(n > 0 && n <= ngramN);
-  NgramValue *value = ngramTable.getValue(ngram);
+void Ngrams::prune() {
+  int minCount = 0;
+  do {
+    ++minCount;
+    NgramTable *table =
+        NgramTable::create(options.tableType, options.partitions);
+    memset(uniques, 0, ngramN * sizeof(int64_t));
+    size_t count = ngramTable->count();
+    for (size_t i = 0; i < count; i++) {
+      NgramValue &value = ngramTable->getValue(i);
+      if (value.frequency > minCount) {
+        size_t length;
+        const char *key = ngramTable->getKey(i, length);
+        bool added;
+        table->add(key, length, value.n, added)->frequency = value.frequency;
+        ++uniques[value.n - 1];
+      }
+    }
+    delete ngramTable;
+    ngramTable = table;
+  } while (ngramTable->getMemoryUsage() > options.maxMemory / 2 &&
+           ngramTable->count() > 0);
+
+  // a ngram pruned now may be seen again, its count is then short by at most
+  // minCount
+  prunedCount += minCount;
+  fprintf(stderr, "Pruned ngrams seen %d times or less to save memory.\n",
+          minCount);
 
-  if (value) // existing ngram, increase frequent count by 1
-  {
-    ++value->frequency;
-  } else // new ngram, add it
-  {
-    ngramTable.add(ngram, NgramValue(n, 1));
-    ++uniques[n - 1];
+  this->resetCursors();
+}
+
+void Ngrams::enableDirectCounts(int n) {
+  assert(n <= 2 && tokenSeparator == 0);
+  directN = std::min(n, ngramN);
+  delete[] directCounts;
+  directCounts = new uint32_t[DIRECT_COUNTS];
+  memset(directCounts, 0, DIRECT_COUNTS * sizeof(uint32_t));
+}
+
+void Ngrams::addByteTokens(const char *begin, const char *end) {
+  if (directN < ngramN || router || overflowing || begin == end) {
+    for (const char *p = begin; p < end; p++) {
+      this->addToken(p, 1);
+    }
+    return;
+  }
+
+  // every ngram is counted directly, the queue only keeps the last byte. The
+  // counts are flushed before any of them may overflow 32 bits.
+  while (begin < end) {
+    if (directTokens == DIRECT_FLUSH_TOKENS) {
+      this->flushDirectCounts();
+    }
+    const unsigned char *p = (const unsigned char *)begin;
+    size_t length = std::min((size_t)(end - begin),
+                             (size_t)(DIRECT_FLUSH_TOKENS - directTokens));
+    if (ngramN == 2) {
+      if (tokenCount > 0) {
+        int previous = (unsigned char)window[windowLength - 1];
+        ++directCounts[256 + (previous << 8 | p[0])];
+      }
+      for (size_t i = 0; i + 1 < length; i++) {
+        ++directCounts[256 + (p[i] << 8 | p[i + 1])];
+      }
+    }
+    for (size_t i = 0; i < length; i++) {
+      ++directCounts[p[i]];
+    }
+    directTokens += length;
+    begin += length;
+    queueHead = 0;
+    tokenCount = 0;
+    windowLength = 0;
+    this->pushQueue(begin - 1, 1);
   }
-  ++totals[n - 1];
 }
 
-int Ngrams::pushQueue(const char *token) {
-  TokenNode *tokenNode = new TokenNode(token);
-  if (!head) {
-    head = tokenNode;
-  } else {
-    this->tail->next = tokenNode;
+void Ngrams::flushDirectCounts() {
+  int count = directN == 0 ? 0 : directN == 1 ? 256 : DIRECT_COUNTS;
+  for (int i = 0; i < count; i++) {
+    if (directCounts[i]) {
+      // the 1-grams by their byte, then the 2-grams by their two bytes
+      char key[2];
+      int n = i < 256 ? 1 : 2;
+      key[0] = (char)(n == 1 ? i : (i - 256) >> 8);
+      key[1] = (char)(i & 0xff);
+      this->addNgram(key, n, n, directCounts[i]);
+      directCounts[i] = 0;
+    }
+  }
+  directTokens = 0;
+}
+
+void Ngrams::resetCursors() {
+  for (int i = 0; i < tokenCount; i++) {
+    int slot = (queueHead + i) % ngramN;
+    keyCursors[slot] = ngramTable->advance(
+        ngramTable->getCursor(), window + tokenOffsets[slot],
+        windowLength - tokenOffsets[slot]);
+  }
+}
+
+bool Ngrams::spill() {
+  size_t count = ngramTable->count();
+  size_t *sorted = new size_t[count];
+  for (size_t i = 0; i < count; i++) {
+    sorted[i] = i;
+  }
+  NgramTable *table = ngramTable;
+  std::sort(sorted, sorted + count, [table](size_t a, size_t b) {
+    size_t lengthA;
+    size_t lengthB;
+    const char *keyA = table->getKey(a, lengthA);
+    const char *keyB = table->getKey(b, lengthB);
+    return NgramRun::compare(keyA, lengthA, table->getValue(a).n, keyB,
+                             lengthB, table->getValue(b).n) < 0;
+  });
+
+  NgramRun *run = new NgramRun();
+  if (!run->create()) {
+    // count on in memory
+    fprintf(stderr, "Ngrams:spill - failed to create a run file\n");
+    delete run;
+    delete[] sorted;
+    options.memoryLimit = 0;
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    size_t length;
+    const char *key = ngramTable->getKey(sorted[i], length);
+    NgramValue &value = ngramTable->getValue(sorted[i]);
+    run->add(key, length, value.n, (uint64_t)value.frequency);
+  }
+  delete[] sorted;
+  runs.add(run);
+
+  delete ngramTable;
+  ngramTable = NgramTable::create(options.tableType, options.partitions);
+  this->resetCursors();
+  return true;
+}
+
+void Ngrams::mergeRuns() {
+  // if the table can not be spilled, the runs are added to it
+  bool leftOver = !this->spill();
+  fprintf(stderr, "Merging %d runs of spilled ngrams.\n", (int)runs.count());
+  NgramRunMerger merger;
+  for (size_t i = 0; i < runs.count(); i++) {
+    merger.add(runs[i]);
+  }
+  runs.clear();
+  // the ngrams merged at the end of an earlier input are merged in again
+  for (size_t i = 0; i < mergedRuns.count(); i++) {
+    merger.add(mergedRuns[i]);
   }
-  this->tail = tokenNode;
+  mergedRuns.clear();
+  merger.rewind();
+
+  // the merged ngrams of each N go to a run of their own
+  for (int i = 0; i < ngramN && !leftOver; i++) {
+    NgramRun *run = new NgramRun();
+    if (!run->create()) {
+      fprintf(stderr, "Ngrams:mergeRuns - failed to create a run file\n");
+      delete run;
+      leftOver = true;
+    } else {
+      mergedRuns.add(run);
+    }
+  }
+  if (leftOver) {
+    for (size_t i = 0; i < mergedRuns.count(); i++) {
+      delete mergedRuns[i];
+    }
+    mergedRuns.clear();
+  }
+
+  memset(uniques, 0, ngramN * sizeof(int64_t));
+  size_t count = leftOver ? ngramTable->count() : 0;
+  for (size_t i = 0; i < count; i++) {
+    ++uniques[ngramTable->getValue(i).n - 1];
+  }
+  utf8_string key;
+  key.reserve(256);
+  bool more = merger.next();
+  while (more) {
+    key.empty();
+    key.append(merger.getKey(), merger.getKeyLength());
+    int n = merger.getN();
+    uint64_t frequency = 0;
+    do {
+      frequency += merger.getFrequency();
+      more = merger.next();
+    } while (more && NgramRun::compare(merger.getKey(), merger.getKeyLength(),
+                                       merger.getN(), key.c_str(),
+                                       key.length(), n) == 0);
+    bool added = true;
+    if (leftOver) {
+      ngramTable->add(key.c_str(), key.length(), n, added)->frequency +=
+          (int64_t)frequency;
+    } else {
+      mergedRuns[n - 1]->add(key.c_str(), key.length(), n, frequency);
+    }
+    if (added) {
+      ++uniques[n - 1];
+    }
+  }
+}
+
+void Ngrams::loadMergedRuns() {
+  for (size_t i = 0; i < mergedRuns.count(); i++) {
+    NgramRun *run = mergedRuns[i];
+    if (!run->rewind()) {
+      fprintf(stderr, "Ngrams:loadMergedRuns - failed to write a run file\n");
+    }
+    while (run->next()) {
+      bool added;
+      ngramTable->add(run->getKey(), run->getKeyLength(), run->getN(), added)
+          ->frequency += (int64_t)run->getFrequency();
+    }
+    delete run;
+  }
+  mergedRuns.clear();
+}
+
+void Ngrams::parse() {
+  int newest = (queueHead + tokenCount - 1) % ngramN;
+  size_t tokenStart = tokenOffsets[newest];
+  // older ngrams are extended by the separator and the newest token
+  size_t extensionStart = tokenSeparator ? tokenStart - 1 : tokenStart;
+
+  // ngrams starting at overflow tokens belong to the next shard
+  int ngramCount = tokenCount - overflowTokens;
+  if (router) {
+    for (int i = 0; i < ngramCount; i++) {
+      int slot = (queueHead + i) % ngramN;
+      size_t start = slot == newest ? tokenStart : extensionStart;
+      if (slot == newest) {
+        keyCursors[slot] = router->getCursor();
+      }
+      keyCursors[slot] = router->advance(keyCursors[slot], window + start,
+                                         windowLength - start);
+      router->add(producer, keyCursors[slot], window + tokenOffsets[slot],
+                  windowLength - tokenOffsets[slot], tokenCount - i);
+      ++totals[tokenCount - i - 1];
+    }
+    return;
+  }
+
+  // the ngrams of N up to directN are the newest ones
+  int tableCount = ngramCount;
+  if (directN > 0) {
+    tableCount = std::min(ngramCount, tokenCount - directN);
+    for (int i = std::max(tableCount, 0); i < ngramCount; i++) {
+      int slot = (queueHead + i) % ngramN;
+      const unsigned char *key =
+          (const unsigned char *)window + tokenOffsets[slot];
+      int n = tokenCount - i;
+      ++directCounts[n == 1 ? key[0] : 256 + (key[0] << 8 | key[1])];
+    }
+    if (++directTokens == DIRECT_FLUSH_TOKENS) {
+      this->flushDirectCounts();
+    }
+  }
+
+  if (sketch || uniqueSketches) {
+    for (int i = 0; i < tableCount; i++) {
+      int slot = (queueHead + i) % ngramN;
+      this->addApproximateNgram(window + tokenOffsets[slot],
+                                windowLength - tokenOffsets[slot],
+                                tokenCount - i, 1);
+    }
+    return;
+  }
+
+  for (int i = 0; i < tableCount; i++) {
+    int slot = (queueHead + i) % ngramN;
+    size_t start = slot == newest ? tokenStart : extensionStart;
+    if (tokenCount - i == directN + 1) {
+      // the shortest ngram in the table walks its chars from the root
+      keyCursors[slot] = ngramTable->getCursor();
+      start = tokenOffsets[slot];
+    }
+    keyCursors[slot] = ngramTable->advance(keyCursors[slot], window + start,
+                                           windowLength - start);
+    this->addNgram(keyCursors[slot], window + tokenOffsets[slot],
+                   windowLength - tokenOffsets[slot], tokenCount - i);
+  }
+}
+
+int Ngrams::pushQueue(const char *token, size_t length) {
+  assert(tokenCount < ngramN);
+  size_t needed = length + 2; // separator and null terminator
+
+  if (windowLength + needed > windowSize) {
+    // move queued tokens to the front of the window
+    size_t start = tokenCount > 0 ? tokenOffsets[queueHead] : windowLength;
+    windowLength -= start;
+    memmove(window, window + start, windowLength);
+    for (int i = 0; i < tokenCount; i++) {
+      tokenOffsets[(queueHead + i) % ngramN] -= start;
+    }
+    if (windowLength + needed > windowSize) {
+      windowSize = (windowLength + needed) << 1;
+      window = (char *)realloc(window, windowSize);
+    }
+  }
+
+  if (tokenCount > 0 && tokenSeparator) {
+    window[windowLength++] = tokenSeparator;
+  }
+  tokenOffsets[(queueHead + tokenCount) % ngramN] = windowLength;
+  memcpy(window + windowLength, token, length);
+  windowLength += length;
+  window[windowLength] = 0;
   return ++tokenCount;
 }
 
 void Ngrams::popQueue() {
-  if (head) {
-    if (head == tail) {
-      tail = 0;
-    }
-    TokenNode *p = head->next;
-    delete head;
-    head = p;
+  if (tokenCount > 0) {
+    queueHead = (queueHead + 1) % ngramN;
     --tokenCount;
   }
 }
+
+/**
+ * orders ngram tokens by ngram, for a max heap of the first ngrams
+ */
+static bool ngramLess(const INgrams::NgramToken *a,
+                      const INgrams::NgramToken *b) {
+  return strcmp(a->ngram.c_str(), b->ngram.c_str()) < 0;
+}
+
+void Ngrams::collectNgrams(NgramTable *table, int n,
+                           ngram_vector<NgramToken *> *ngramVector) {
+  size_t count = table->count();
+  utf8_string ngram;
+  ngram.reserve(256);
+  for (size_t i = 0; i < count; i++) {
+    NgramValue &value = table->getValue(i);
+    if (value.n == n && value.frequency >= options.minCount) {
+      size_t length;
+      const char *key = table->getKey(i, length);
+      ngram.empty();
+      this->decodeNgram(key, length, n, ngram);
+      ngramVector->add(new NgramToken(ngram, value));
+    }
+  }
+}
+
+void Ngrams::collectPartitions(ngram_vector<NgramToken *> &ngramVector,
+                               int n) {
+  PartitionedNgramTable *table =
+      static_cast<PartitionedNgramTable *>(ngramTable);
+  int partitionCount = table->getPartitionCount();
+  ngram_vector<NgramToken *> *collected =
+      new ngram_vector<NgramToken *>[partitionCount];
+  std::thread *threads = new std::thread[partitionCount];
+  for (int i = 0; i < partitionCount; i++) {
+    threads[i] = std::thread(&Ngrams::collectNgrams, this, table->getTable(i),
+                             n, &collected[i]);
+  }
+  size_t collectedCount = 0;
+  for (int i = 0; i < partitionCount; i++) {
+    threads[i].join();
+    collectedCount += collected[i].count();
+  }
+  ngramVector.reserve(ngramVector.count() + collectedCount);
+  for (int i = 0; i < partitionCount; i++) {
+    for (size_t j = 0; j < collected[i].count(); j++) {
+      ngramVector.add(collected[i][j]);
+    }
+  }
+  delete[] threads;
+  delete[] collected;
+}
+
+void Ngrams::getNgrams(ngram_vector<NgramToken *> &ngramVector, int n) {
+  this->loadMergedRuns();
+  size_t count = ngramTable->count();
+  size_t top = (size_t)options.getTop(n);
+  int minCount = options.minCount;
+  utf8_string ngram;
+  ngram.reserve(256);
+  if (top == 0 || top >= (size_t)this->count(n)) {
+    if (options.partitions > 1) {
+      this->collectPartitions(ngramVector, n);
+    } else {
+      this->collectNgrams(ngramTable, n, &ngramVector);
+    }
+    return;
+  }
+
+  // the top frequencies, in a min heap
+  int64_t *frequencies = new int64_t[top];
+  size_t heapSize = 0;
+  for (size_t i = 0; i < count; i++) {
+    NgramValue &value = ngramTable->getValue(i);
+    if (value.n != n || value.frequency < minCount) {
+      continue;
+    }
+    if (heapSize < top) {
+      frequencies[heapSize++] = value.frequency;
+      std::push_heap(frequencies, frequencies + heapSize,
+                     std::greater<int64_t>());
+    } else if (value.frequency > frequencies[0]) {
+      std::pop_heap(frequencies, frequencies + top, std::greater<int64_t>());
+      frequencies[top - 1] = value.frequency;
+      std::push_heap(frequencies, frequencies + top, std::greater<int64_t>());
+    }
+  }
+
+  // ngrams more frequent than the threshold are all output, the rest of the
+  // places go to the first of the ngrams as frequent as the threshold. When
+  // fewer than top are frequent enough, they are all output.
+  int64_t threshold = heapSize < top ? minCount : frequencies[0];
+  size_t places = top;
+  for (size_t i = 0; i < heapSize; i++) {
+    if (frequencies[i] > threshold) {
+      --places;
+    }
+  }
+  delete[] frequencies;
+
+  NgramToken **ties = new NgramToken *[places];
+  size_t tieCount = 0;
+  for (size_t i = 0; i < count; i++) {
+    NgramValue &value = ngramTable->getValue(i);
+    if (value.n != n || value.frequency < threshold) {
+      continue;
+    }
+    size_t length;
+    const char *key = ngramTable->getKey(i, length);
+    ngram.empty();
+    this->decodeNgram(key, length, n, ngram);
+    if (value.frequency > threshold) {
+      ngramVector.add(new NgramToken(ngram, value));
+    } else if (tieCount < places) {
+      ties[tieCount++] = new NgramToken(ngram, value);
+      std::push_heap(ties, ties + tieCount, ngramLess);
+    } else if (strcmp(ngram.c_str(), ties[0]->ngram.c_str()) < 0) {
+      std::pop_heap(ties, ties + places, ngramLess);
+      delete ties[places - 1];
+      ties[places - 1] = new NgramToken(ngram, value);
+      std::push_heap(ties, ties + places, ngramLess);
+    }
+  }
+  for (size_t i = 0; i < tieCount; i++) {
+    ngramVector.add(ties[i]);
+  }
+  delete[] ties;
+}
+
+void Ngrams::writeNgrams(OutputWriter &out, int n) {
+  size_t top = (size_t)options.getTop(n);
+  if (mergedRuns.count() > 0 && (top == 0 || top >= (size_t)this->count(n))) {
+    if (!this->writeMergedNgrams(out, n)) {
+      printf("Ngrams:output - failed to output the spilled %d-grams\n", n);
+    }
+    return;
+  }
+  ngram_vector<NgramToken *> ngramVector;
+  this->getNgrams(ngramVector, n);
+  this->sortNgrams(ngramVector);
+  for (size_t i = 0; i < ngramVector.count(); i++) {
+    NgramToken *ngramToken = ngramVector[i];
+    out.writeNgram(ngramToken->ngram.c_str(), ngramToken->ngram.length(),
+                   ngramToken->value.frequency);
+    delete ngramToken;
+  }
+}
+
+bool Ngrams::writeMergedNgrams(OutputWriter &out, int n) {
+  // the sort key is the inverted frequency, high byte first, then the ngram
+  enum { FREQUENCY_BYTES = sizeof(uint64_t) };
+  NgramRunSorter sorter(options.memoryLimit);
+  NgramRun *run = mergedRuns[n - 1];
+  utf8_string sortKey;
+  sortKey.reserve(256);
+  bool ret = run->rewind();
+  while (ret && run->next()) {
+    uint64_t frequency = run->getFrequency();
+    if ((int64_t)frequency < options.minCount) {
+      continue;
+    }
+    char bytes[FREQUENCY_BYTES];
+    for (int i = 0; i < FREQUENCY_BYTES; i++) {
+      bytes[i] = (char)(~frequency >> (FREQUENCY_BYTES - 1 - i) * 8);
+    }
+    sortKey.empty();
+    sortKey.append(bytes, FREQUENCY_BYTES);
+    this->decodeNgram(run->getKey(), run->getKeyLength(), n, sortKey);
+    sorter.add(sortKey.c_str(), sortKey.length(), n, frequency);
+  }
+  ret = ret && sorter.rewind();
+  while (ret && sorter.next()) {
+    out.writeNgram(sorter.getKey() + FREQUENCY_BYTES,
+                   sorter.getKeyLength() - FREQUENCY_BYTES,
+                   (int64_t)sorter.getFrequency());
+  }
+  return ret;
+}
+
+bool Ngrams::writeMergedNgrams(NgramFileWriter &writer, int n) {
+  NgramRunSorter *sorter =
+      this->reordersFileKeys() ? new NgramRunSorter(options.memoryLimit) : NULL;
+  NgramRun *run = mergedRuns[n - 1];
+  utf8_string fileKey;
+  fileKey.reserve(256);
+  bool ret = run->rewind();
+  while (ret && run->next()) {
+    if ((int64_t)run->getFrequency() < options.minCount) {
+      continue;
+    }
+    fileKey.empty();
+    this->encodeFileKey(run->getKey(), run->getKeyLength(), n, fileKey);
+    if (sorter) {
+      sorter->add(fileKey.c_str(), fileKey.length(), n, run->getFrequency());
+    } else {
+      writer.addNgram(fileKey.c_str(), fileKey.length(), run->getFrequency());
+    }
+  }
+  if (sorter) {
+    ret = ret && sorter->rewind();
+    while (ret && sorter->next()) {
+      writer.addNgram(sorter->getKey(), sorter->getKeyLength(),
+                      sorter->getFrequency());
+    }
+    delete sorter;
+  }
+  return ret;
+}
+
+void Ngrams::visit(NgramVisitor &visitor, int n) {
+  this->loadMergedRuns();
+  utf8_string ngram;
+  ngram.reserve(256);
+  size_t count = ngramTable->count();
+  for (size_t i = 0; i < count; i++) {
+    NgramValue &value = ngramTable->getValue(i);
+    if ((n != 0 && (int)value.n != n) || value.frequency < options.minCount) {
+      continue;
+    }
+    size_t length;
+    const char *key = ngramTable->getKey(i, length);
+    ngram.empty();
+    this->decodeNgram(key, length, value.n, ngram);
+    visitor.visit(ngram.c_str(), ngram.length(), value.n, value.frequency);
+  }
+}
+
+void Ngrams::output() {
+  if (options.format == Config::BINARY_FORMAT) {
+    outputBinary();
+  } else {
+    outputText();
+  }
+}
+
+/**
+ * a ngram of a binary ngram count file, its key is in a buffer of keys
+ */
+struct FileNgram {
+  size_t keyOffset; // offset of the key in the buffer
+  size_t keyLength;
+  uint64_t frequency;
+};
+
+void Ngrams::outputBinary() {
+  NgramFileWriter writer;
+  if (!writer.open(outFileName.c_str(), getType(), ngramN)) {
+    printf("Ngrams:output - failed to open file %s\n", outFileName.c_str());
+    return;
+  }
+  writer.setPrunedCount(prunedCount);
+  this->writeVocabulary(writer);
+  if (sketch) {
+    fprintf(stderr,
+            "Counts are approximate, frequencies may be up to %" PRId64
+            " too high.\n",
+            this->getErrorBound());
+  }
+  if (uniqueSketches) {
+    fprintf(stderr,
+            "Unique ngrams are estimated, with a standard error of %.2f%%.\n",
+            this->getUniquesError() * 100);
+  }
+
+  size_t count = ngramTable->count();
+  utf8_string fileKey;
+  fileKey.reserve(256);
+  size_t keysSize = 1 << 20;
+  char *keys = (char *)malloc(keysSize);
+  for (int n = 1; n <= ngramN; n++) {
+    fprintf(stderr,
+            "Total %" PRId64 " unique ngrams in %" PRId64 " %d-grams.\n",
+            this->count(n), this->total(n), n);
+    writer.beginOrder(n);
+    if (mergedRuns.count() > 0) {
+      if (!this->writeMergedNgrams(writer, n)) {
+        printf("Ngrams:output - failed to output the spilled %d-grams\n", n);
+      }
+      writer.endOrder((uint64_t)this->total(n), (uint64_t)this->count(n));
+      continue;
+    }
+    // estimated unique ngrams are not in the table
+    FileNgram *ngrams =
+        new FileNgram[std::min((size_t)this->count(n), count)];
+    size_t ngramCount = 0;
+    size_t keysLength = 0;
+    for (size_t i = 0; i < count; i++) {
+      NgramValue &value = ngramTable->getValue(i);
+      if (value.n != n || value.frequency < options.minCount) {
+        continue;
+      }
+      size_t length;
+      const char *key = ngramTable->getKey(i, length);
+      fileKey.empty();
+      this->encodeFileKey(key, length, n, fileKey);
+      if (keysLength + fileKey.length() > keysSize) {
+        keysSize = std::max(keysSize * 2, keysLength + fileKey.length());
+        keys = (char *)realloc(keys, keysSize);
+      }
+      memcpy(keys + keysLength, fileKey.c_str(), fileKey.length());
+      FileNgram &ngram = ngrams[ngramCount++];
+      ngram.keyOffset = keysLength;
+      ngram.keyLength = fileKey.length();
+      ngram.frequency = (uint64_t)value.frequency;
+      keysLength += fileKey.length();
+    }
+
+    std::sort(ngrams, ngrams + ngramCount,
+              [keys](const FileNgram &a, const FileNgram &b) {
+                int ret = memcmp(keys + a.keyOffset, keys + b.keyOffset,
+                                 std::min(a.keyLength, b.keyLength));
+                return ret < 0 || (ret == 0 && a.keyLength < b.keyLength);
+              });
+    for (size_t i = 0; i < ngramCount; i++) {
+      writer.addNgram(keys + ngrams[i].keyOffset, ngrams[i].keyLength,
+                      ngrams[i].frequency);
+    }
+    writer.endOrder((uint64_t)this->total(n), (uint64_t)this->count(n));
+    delete[] ngrams;
+  }
+  free(keys);
+  if (!writer.close()) {
+    printf("Ngrams:output - failed to write file %s\n", outFileName.c_str());
+  }
+}
+
+bool Ngrams::load(const char *fileName) {
+  this->loadMergedRuns();
+  NgramFileReader fileReader;
+  if (*fileName && fileReader.open(fileName)) {
+    return this->loadBinary(fileReader, fileName);
+  }
+  NgramTextReader textReader;
+  if (!textReader.open(fileName)) {
+    printf("Ngrams:load - failed to open file %s\n", fileName);
+    return false;
+  }
+  return this->loadText(textReader, fileName);
+}
+
+bool Ngrams::loadBinary(const NgramFileReader &reader, const char *fileName) {
+  if (reader.getType() != getType()) {
+    printf("Ngrams:load - file %s holds another kind of ngrams\n", fileName);
+    return false;
+  }
+  utf8_string key;
+  key.reserve(256);
+  int maxN = std::min(reader.getN(), ngramN);
+  for (int n = 1; n <= maxN; n++) {
+    size_t keyCount = reader.getKeyCount(n);
+    for (size_t i = 0; i < keyCount; i++) {
+      size_t length;
+      const char *fileKey = reader.getKey(n, i, length);
+      key.empty();
+      if (!this->decodeFileKey(reader, fileKey, length, n, key)) {
+        printf("Ngrams:load - file %s holds an unknown word id\n", fileName);
+        return false;
+      }
+      int64_t frequency = (int64_t)reader.getFrequency(n, i);
+      this->addNgram(key.c_str(), key.length(), n, frequency);
+      // the total is taken from the file, ngrams may have been left out
+      totals[n - 1] -= frequency;
+    }
+    totals[n - 1] += (int64_t)reader.total(n);
+  }
+  prunedCount += (int64_t)reader.getPrunedCount();
+  return true;
+}
+
+bool Ngrams::loadText(NgramTextReader &reader, const char *fileName) {
+  utf8_string key;
+  key.reserve(256);
+  int n = 0;
+  int skipped = 0;
+  int entry;
+  while ((entry = reader.next()) != NgramTextReader::END) {
+    if (entry == NgramTextReader::ORDER) {
+      if (reader.getType() != getType()) {
+        printf("Ngrams:load - file %s holds another kind of ngrams\n",
+               fileName);
+        return false;
+      }
+      n = reader.getN();
+      if (n >= 1 && n <= ngramN) {
+        totals[n - 1] += reader.getTotal();
+      }
+    } else if (n >= 1 && n <= ngramN) {
+      size_t length;
+      const char *ngram = reader.getNgram(length);
+      key.empty();
+      if (!this->encodeNgram(ngram, length, n, key)) {
+        ++skipped;
+        continue;
+      }
+      int64_t frequency = reader.getFrequency();
+      this->addNgram(key.c_str(), key.length(), n, frequency);
+      totals[n - 1] -= frequency;
+    }
+  }
+  prunedCount += reader.getPrunedCount();
+  if (skipped) {
+    fprintf(stderr, "Ngrams:load - skipped %d ngrams of %s that can not be "
+                    "told apart from the text.\n",
+            skipped, fileName);
+  }
+  return true;
+}
@@ -22,8 +22,13 @@ Email me at jerryy@gmail.com if you have any question or comment
 WebSite: http://www.cs.dal.ca/~zyu
 
 *************************************************************************/
+#include <cctype>
+#include <cstring>
 #include <ctime>
 #include <iostream>
+#ifndef _WIN32
+#include <glob.h>
+#endif
 
 #include <ngram/config.h>
 #include <ngram/text2wfreq.h>
@@ -57,11 +62,249 @@ bool Text2wfreq::getOptions(int argc, char *argv[]) {
   value = Config::getOptionValue("-n", argc, argv);
 
   if (value != "") {
-    sscanf(value.c_str(), "%d", &ngramN);
+    if (sscanf(value.c_str(), "%d", &ngramN) != 1 || ngramN < 1 ||
+        ngramN > INgrams::MAX_N) {
+      printf("wrong n option!\n");
+      return false;
+    }
+  }
+
+  value = Config::getOptionValue("-table", argc, argv);
+
+  if (value == "hash") {
+    ngramOptions.tableType = Config::HASH_TABLE;
+  } else if (value == "tst") {
+    ngramOptions.tableType = Config::TST_TABLE;
+  } else if (value != "") {
+    printf("wrong table option!\n");
+    return false;
+  }
+
+  value = Config::getOptionValue("-threads", argc, argv);
+
+  if (value != "") {
+    if (sscanf(value.c_str(), "%d", &ngramOptions.threads) != 1 ||
+        ngramOptions.threads < 1) {
+      printf("wrong threads option!\n");
+      return false;
+    }
+  }
+
+  value = Config::getOptionValue("-partitions", argc, argv);
+
+  if (value != "") {
+    if (sscanf(value.c_str(), "%d", &ngramOptions.partitions) != 1 ||
+        ngramOptions.partitions < 1) {
+      printf("wrong partitions option!\n");
+      return false;
+    }
+  }
+
+  value = Config::getOptionValue("-top", argc, argv);
+
+  if (value != "") {
+    // K, or K1,K2,... for each N
+    const char *p = value.c_str();
+    while (*p) {
+      char *end;
+      long top = strtol(p, &end, 10);
+      if (end == p || top < 0 || (*end && *end != ',')) {
+        printf("wrong top option!\n");
+        return false;
+      }
+      ngramOptions.top.add((int)top);
+      p = *end ? end + 1 : end;
+    }
+  }
+
+  value = Config::getOptionValue("-min-count", argc, argv);
+
+  if (value != "") {
+    if (sscanf(value.c_str(), "%d", &ngramOptions.minCount) != 1 ||
+        ngramOptions.minCount < 0) {
+      printf("wrong min-count option!\n");
+      return false;
+    }
+  }
+
+  value = Config::getOptionValue("-max-memory", argc, argv);
+
+  if (value != "") {
+    int megabytes;
+    if (sscanf(value.c_str(), "%d", &megabytes) != 1 || megabytes < 0) {
+      printf("wrong max-memory option!\n");
+      return false;
+    }
+    ngramOptions.maxMemory = (size_t)megabytes << 20;
+    if (ngramOptions.maxMemory && ngramOptions.partitions > 1) {
+      printf("max-memory and partitions options can not be combined!\n");
+      return false;
+    }
+  }
+
+  value = Config::getOptionValue("-memory-limit", argc, argv);
+
+  if (value != "") {
+    int megabytes;
+    if (sscanf(value.c_str(), "%d", &megabytes) != 1 || megabytes < 0) {
+      printf("wrong memory-limit option!\n");
+      return false;
+    }
+    ngramOptions.memoryLimit = (size_t)megabytes << 20;
+  }
+
+  value = Config::getOptionValue("-format", argc, argv);
+
+  if (value == "binary") {
+    ngramOptions.format = Config::BINARY_FORMAT;
+  } else if (value == "text") {
+    ngramOptions.format = Config::TEXT_FORMAT;
+  } else if (value != "") {
+    printf("wrong format option!\n");
+    return false;
+  }
+
+  ngramOptions.documentBoundaries =
+      Config::hasOption("-doc-boundaries", argc, argv);
+
+  value = Config::getOptionValue("-approx", argc, argv);
+
+  if (value == "cms") {
+    ngramOptions.approximation = Config::COUNT_MIN_SKETCH;
+  } else if (value != "") {
+    printf("wrong approx option!\n");
+    return false;
+  }
+
+  value = Config::getOptionValue("-sketch-width", argc, argv);
+
+  if (value != "") {
+    int width;
+    if (sscanf(value.c_str(), "%d", &width) != 1 || width < 1) {
+      printf("wrong sketch-width option!\n");
+      return false;
+    }
+    ngramOptions.sketchWidth = (size_t)width;
+  }
+
+  value = Config::getOptionValue("-sketch-depth", argc, argv);
+
+  if (value != "") {
+    if (sscanf(value.c_str(), "%d", &ngramOptions.sketchDepth) != 1 ||
+        ngramOptions.sketchDepth < 1 || ngramOptions.sketchDepth > 32) {
+      printf("wrong sketch-depth option!\n");
+      return false;
+    }
+  }
+
+  value = Config::getOptionValue("-heavy-hitters", argc, argv);
+
+  if (value != "") {
+    int hitters;
+    if (sscanf(value.c_str(), "%d", &hitters) != 1 || hitters < 1) {
+      printf("wrong heavy-hitters option!\n");
+      return false;
+    }
+    ngramOptions.heavyHitters = (size_t)hitters;
+  }
+
+  if (Config::hasOption("-estimate-uniques", argc, argv)) {
+    if (ngramOptions.approximation != Config::EXACT_COUNTS) {
+      printf("estimate-uniques and approx options can not be combined!\n");
+      return false;
+    }
+    ngramOptions.approximation = Config::HYPER_LOG_LOG;
+  }
+
+  value = Config::getOptionValue("-uniques-precision", argc, argv);
+
+  if (value != "") {
+    if (sscanf(value.c_str(), "%d", &ngramOptions.uniquesPrecision) != 1 ||
+        ngramOptions.uniquesPrecision < HyperLogLog::MIN_PRECISION ||
+        ngramOptions.uniquesPrecision > HyperLogLog::MAX_PRECISION) {
+      printf("wrong uniques-precision option!\n");
+      return false;
+    }
+  }
+
+  value = Config::getOptionValue("-expected-uniques", argc, argv);
+
+  if (value == "auto") {
+    ngramOptions.sampleUniques = true;
+  } else if (value != "") {
+    long long expected;
+    if (sscanf(value.c_str(), "%lld", &expected) != 1 || expected < 1) {
+      printf("wrong expected-uniques option!\n");
+      return false;
+    }
+    ngramOptions.expectedUniques = (size_t)expected;
   }
 
   inFileName = Config::getOptionValue("-in", argc, argv).c_str();
   outFileName = Config::getOptionValue("-out", argc, argv).c_str();
 
+  // a name with spaces is taken as a whole if there is such a file
+  FILE *fp = inFileName.empty() ? NULL : fopen(inFileName.c_str(), "rb");
+  if (fp || inFileName.empty()) {
+    inFileNames.add(strdup(inFileName.c_str()));
+    if (fp) {
+      fclose(fp);
+    }
+    return true;
+  }
+  const char *p = inFileName.c_str();
+  while (*p) {
+    while (isspace((unsigned char)*p)) {
+      p++;
+    }
+    const char *itemEnd = p;
+    while (*itemEnd && !isspace((unsigned char)*itemEnd)) {
+      itemEnd++;
+    }
+    if (itemEnd > p && !addInFiles(string(p, itemEnd - p).c_str())) {
+      return false;
+    }
+    p = itemEnd;
+  }
+
+  return true;
+}
+
+bool Text2wfreq::addInFiles(const char *item) {
+  if (item[0] == '@') {
+    FILE *list = fopen(item + 1, "r");
+    if (!list) {
+      printf("Text2wfreq:getOptions - failed to open file list %s\n",
+             item + 1);
+      return false;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), list)) {
+      size_t length = strlen(line);
+      while (length > 0 &&
+             (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+        line[--length] = 0;
+      }
+      if (length > 0) {
+        inFileNames.add(strdup(line));
+      }
+    }
+    fclose(list);
+    return true;
+  }
+#ifndef _WIN32
+  if (strpbrk(item, "*?[")) {
+    // a pattern that matches nothing is kept, to fail opening
+    glob_t matches;
+    if (glob(item, GLOB_NOCHECK, NULL, &matches) == 0) {
+      for (size_t i = 0; i < matches.gl_pathc; i++) {
+        inFileNames.add(strdup(matches.gl_pathv[i]));
+      }
+    }
+    globfree(&matches);
+    return true;
+  }
+#endif
+  inFileNames.add(strdup(item));
   return true;
 }
\ No newline at end of file
@@ -165,7 +165,7 @@ utf8_string &utf8_string::append(const char *str, std::size_t len) {
   return *this;
 }
 
-inline utf8_string &utf8_string::append(int c) {
+utf8_string &utf8_string::append(int c) {
   std::size_t len = this->length();
   if (len + 1 >= this->getSize())
     this->resize(len + 2);
@@ -1,17 +1,846 @@
 #include <ngram/char_ngrams.h>
+#include <ngram/ngram_merger.h>
 #include <ngram/word_ngrams.h>
 #include <ngram/byte_ngrams.h>
+#include <ngram/hash_ngram_table.h>
 #include <ngram/text2wfreq.h>
 
+#include <map>
+#include <string>
+#include <vector>
+#include <math.h>
+
 #include "lest.hpp"
 
 using namespace std;
 
+/**
+ * write given text into a temporary file and return the file name
+ */
+static const char *writeTempFile(const char *text) {
+  static const char *fileName = "ngram_test_input.tmp";
+  FILE *fp = fopen(fileName, "wb");
+  fputs(text, fp);
+  fclose(fp);
+  return fileName;
+}
+
+/**
+ * read the ngram lines of given N from a text output file
+ */
+static vector<string> readNgramLines(const char *fileName, int n) {
+  vector<string> lines;
+  FILE *fp = fopen(fileName, "rb");
+  if (fp == NULL) {
+    return lines;
+  }
+  char line[1024];
+  string header = to_string(n) + "-GRAMS\n";
+  bool found = false;
+  while (fgets(line, sizeof(line), fp)) {
+    if (found) {
+      if (line[0] == '\n') {
+        break;
+      }
+      lines.push_back(line);
+    } else if (header == line) {
+      found = true;
+      // skip the total and the rule
+      fgets(line, sizeof(line), fp);
+      fgets(line, sizeof(line), fp);
+    }
+  }
+  fclose(fp);
+  return lines;
+}
+
 const lest::test specification[] = {
     CASE("hello world!") {
         auto hw = "Hello, world!";
         EXPECT(hw == hw);
     },
+
+    CASE("word ngrams are counted once each") {
+        WordNgrams ngrams(3, writeTempFile("a b c a b"), "");
+        EXPECT(ngrams.total(1) == 5);
+        EXPECT(ngrams.total(2) == 4);
+        EXPECT(ngrams.total(3) == 3);
+        EXPECT(ngrams.count(1) == 3);
+        EXPECT(ngrams.count(2) == 3);
+        EXPECT(ngrams.count(3) == 3);
+    },
+
+    CASE("input shorter than N yields every shorter ngram once") {
+        WordNgrams words(3, writeTempFile("hello world"), "");
+        EXPECT(words.total(1) == 2);
+        EXPECT(words.total(2) == 1);
+        EXPECT(words.total(3) == 0);
+
+        CharNgrams chars(4, writeTempFile("abc"), "");
+        EXPECT(chars.total(1) == 3);
+        EXPECT(chars.total(3) == 1);
+        EXPECT(chars.total(4) == 0);
+    },
+
+    CASE("byte set classifies blocks like single byte lookups") {
+        ByteSet set;
+        set.add(Config::getDefaultDelimiters());
+        set.add((unsigned char)0);
+        set.add((unsigned char)0xe9);
+        char bytes[256 + ByteSet::BLOCK_SIZE];
+        for (int i = 0; i < (int)sizeof(bytes); i++) {
+            bytes[i] = (char)(i * 7);
+        }
+        for (int i = 0; i < 256; i += 5) {
+            uint32_t mask = set.classify(bytes + i, sizeof(bytes) - i);
+            for (int j = 0; j < ByteSet::BLOCK_SIZE; j++) {
+                bool member = set.contains(bytes[i + j]);
+                EXPECT(((mask >> j) & 1) == (uint32_t)member);
+            }
+        }
+        EXPECT(set.contains(0));
+        EXPECT(set.contains(','));
+        EXPECT(!set.contains('a'));
+        EXPECT(set.classify(",a,", 3) == 5u);
+    },
+
+    CASE("input is read past a 0xff byte") {
+        WordNgrams words(1, writeTempFile("a \xff b"), "");
+        EXPECT(words.total(1) == 3);
+
+        ByteNgrams bytes(1, writeTempFile("\xff\xff!"), "");
+        EXPECT(bytes.total(1) == 3);
+        EXPECT(bytes.count(1) == 2);
+    },
+
+    CASE("character ngrams are counted in UTF-8 chars of either case") {
+        CharNgrams chars(2, writeTempFile("\xd0\x9f\xd1\x80\xd0\xb8 "
+                                          "\xd0\xbf\xd0\xa0\xd0\x98\xff"),
+                         "");
+        // three Cyrillic chars twice, '_' and U+FFFD
+        EXPECT(chars.total(1) == 8);
+        EXPECT(chars.count(1) == 5);
+        EXPECT(chars.total(2) == 7);
+        EXPECT(chars.count(2) == 5);
+    },
+
+    CASE("byte ngrams counted directly match the table counts") {
+        utf8_string text;
+        for (int i = 0; i < 300; i++) {
+            text.append(i % 7 == 0 ? 0 : i % 251);
+        }
+        // the bytes hold NULs, so they are not written with writeTempFile
+        const char *file = "ngram_test_1.tmp";
+        FILE *fp = fopen(file, "wb");
+        fwrite(text.c_str(), 1, text.length(), fp);
+        fclose(fp);
+        NgramOptions threaded;
+        threaded.threads = 3;
+        ByteNgrams pairs(2, file, "");
+        ByteNgrams threadedPairs(2, file, "", "", "", threaded);
+        ByteNgrams triples(3, file, "");
+        for (int n = 1; n <= 2; n++) {
+            EXPECT(pairs.total(n) == 301 - n);
+            EXPECT(pairs.count(n) == triples.count(n));
+            EXPECT(threadedPairs.total(n) == pairs.total(n));
+            EXPECT(threadedPairs.count(n) == pairs.count(n));
+        }
+        EXPECT(pairs.count(1) == 222);
+        EXPECT(pairs.count(2) == 271);
+        remove(file);
+    },
+
+    CASE("counting with threads and partitions matches a single thread") {
+        utf8_string text;
+        for (int i = 0; i < 50; i++) {
+            text += "the cat sat on the mat, 42 cats sat.\n";
+        }
+        NgramOptions threaded;
+        threaded.threads = 7;
+        const char *file = writeTempFile(text.c_str());
+        WordNgrams words(4, file, "");
+        WordNgrams threadedWords(4, file, "", Config::getDefaultDelimiters(),
+                                 Config::getDefaultStopChars(), threaded);
+        CharNgrams chars(4, file, "");
+        CharNgrams threadedChars(4, file, "", Config::getDefaultDelimiters(),
+                                 Config::getDefaultStopChars(), threaded);
+        NgramOptions partitioned = threaded;
+        partitioned.partitions = 3;
+        WordNgrams partitionedWords(4, file, "", Config::getDefaultDelimiters(),
+                                    Config::getDefaultStopChars(), partitioned);
+        for (int n = 1; n <= 4; n++) {
+            EXPECT(words.total(n) == threadedWords.total(n));
+            EXPECT(words.count(n) == threadedWords.count(n));
+            EXPECT(chars.total(n) == threadedChars.total(n));
+            EXPECT(chars.count(n) == threadedChars.count(n));
+            EXPECT(words.total(n) == partitionedWords.total(n));
+            EXPECT(words.count(n) == partitionedWords.count(n));
+        }
+    },
+
+    CASE("several input files are counted as one text or as documents") {
+        const char *fileNames[] = {"ngram_test_1.tmp", "ngram_test_2.tmp",
+                                   "ngram_test_3.tmp"};
+        const char *texts[] = {"a b c", "a b", "c a b c"};
+        for (int i = 0; i < 3; i++) {
+            FILE *fp = fopen(fileNames[i], "wb");
+            fputs(texts[i], fp);
+            fclose(fp);
+        }
+        WordNgrams words(3, writeTempFile("a b c a b c a b c"), "");
+        WordNgrams files(3, NULL, "");
+        files.addFiles(fileNames, 3);
+        NgramOptions threaded;
+        threaded.threads = 2;
+        WordNgrams threadedFiles(3, NULL, "", Config::getDefaultDelimiters(),
+                                 Config::getDefaultStopChars(), threaded);
+        threadedFiles.addFiles(fileNames, 3);
+        for (int n = 1; n <= 3; n++) {
+            EXPECT(files.total(n) == words.total(n));
+            EXPECT(files.count(n) == words.count(n));
+            EXPECT(threadedFiles.total(n) == words.total(n));
+            EXPECT(threadedFiles.count(n) == words.count(n));
+        }
+
+        NgramOptions documents;
+        documents.documentBoundaries = true;
+        WordNgrams documentFiles(3, NULL, "", Config::getDefaultDelimiters(),
+                                 Config::getDefaultStopChars(), documents);
+        documentFiles.addFiles(fileNames, 3);
+        EXPECT(documentFiles.total(1) == 9);
+        EXPECT(documentFiles.total(2) == 6);
+        EXPECT(documentFiles.total(3) == 3);
+        EXPECT(documentFiles.count(3) == 2);
+        for (int i = 0; i < 3; i++) {
+            remove(fileNames[i]);
+        }
+    },
+
+    CASE("input fed from memory is counted as a file and visited") {
+        const char *text = "the cat sat on the mat the cat ran";
+        WordNgrams file(2, writeTempFile(text), "");
+        // the blocks cut words apart
+        WordNgrams fed(2, NULL, NULL);
+        size_t textLength = strlen(text);
+        for (size_t i = 0; i < textLength; i += 4) {
+            fed.feed(text + i, textLength - i < 4 ? textLength - i : 4);
+        }
+        fed.finish();
+        const char *words[] = {"the", "cat", "sat", "on", "the",
+                               "mat", "the", "cat", "ran"};
+        size_t lengths[9];
+        for (int i = 0; i < 9; i++) {
+            lengths[i] = strlen(words[i]);
+        }
+        WordNgrams tokens(2, NULL, NULL);
+        tokens.feedTokens(words, lengths, 9);
+        tokens.finish();
+        for (int n = 1; n <= 2; n++) {
+            EXPECT(fed.total(n) == file.total(n));
+            EXPECT(fed.count(n) == file.count(n));
+            EXPECT(tokens.total(n) == file.total(n));
+            EXPECT(tokens.count(n) == file.count(n));
+        }
+
+        struct Frequencies : NgramVisitor {
+            int64_t total = 0;
+            int64_t theCat = 0;
+            void visit(const char *ngram, size_t length, int n,
+                       int64_t frequency) {
+                total += frequency;
+                if (length == 7 && memcmp(ngram, "the_cat", 7) == 0) {
+                    theCat = frequency;
+                }
+            }
+        } frequencies;
+        fed.visit(frequencies, 2);
+        EXPECT(frequencies.total == fed.total(2));
+        EXPECT(frequencies.theCat == 2);
+    },
+
+    CASE("approximate counts keep the most frequent ngrams") {
+        // "the" and "the_cat" are frequent among many words seen once
+        string text;
+        for (int i = 0; i < 2000; i++) {
+            text += i % 4 == 0 ? "the cat " : "w" + to_string(i) + " ";
+        }
+        NgramOptions options;
+        options.approximation = Config::COUNT_MIN_SKETCH;
+        options.sketchWidth = 256;
+        options.sketchDepth = 4;
+        options.heavyHitters = 16;
+        WordNgrams exact(2, NULL, NULL);
+        WordNgrams approximate(2, NULL, NULL, Config::getDefaultDelimiters(),
+                               Config::getDefaultStopChars(), options);
+        exact.feed(text.c_str(), text.length());
+        exact.finish();
+        approximate.feed(text.c_str(), text.length());
+        approximate.finish();
+        EXPECT(approximate.isApproximate());
+        EXPECT(approximate.getConfidence() > 0.98);
+        for (int n = 1; n <= 2; n++) {
+            EXPECT(approximate.total(n) == exact.total(n));
+            EXPECT(approximate.count(n) == 16);
+        }
+
+        struct Frequencies : NgramVisitor {
+            map<string, int64_t> frequencies;
+            void visit(const char *ngram, size_t length, int n,
+                       int64_t frequency) {
+                frequencies[string(ngram, length)] = frequency;
+            }
+        } exactCounts, approximateCounts;
+        exact.visit(exactCounts);
+        approximate.visit(approximateCounts);
+        EXPECT(approximateCounts.frequencies["the"] >= 500);
+        EXPECT(approximateCounts.frequencies["the_cat"] >= 500);
+        // frequencies are never too low and at most the bound too high
+        int64_t bound = approximate.getErrorBound();
+        for (auto &entry : approximateCounts.frequencies) {
+            int64_t exactFrequency = exactCounts.frequencies[entry.first];
+            EXPECT(entry.second >= exactFrequency);
+            EXPECT(entry.second <= exactFrequency + bound);
+        }
+    },
+
+    CASE("unique ngrams are estimated near the exact counts") {
+        string text;
+        for (int i = 0; i < 20000; i++) {
+            text += "w" + to_string(i * 7919 % 5003) + " ";
+        }
+        const char *file = writeTempFile(text.c_str());
+        NgramOptions estimated;
+        estimated.approximation = Config::HYPER_LOG_LOG;
+        NgramOptions threaded = estimated;
+        threaded.threads = 3;
+        WordNgrams exact(3, file, "");
+        WordNgrams words(3, file, "", Config::getDefaultDelimiters(),
+                         Config::getDefaultStopChars(), estimated);
+        WordNgrams threadedWords(3, file, "", Config::getDefaultDelimiters(),
+                                 Config::getDefaultStopChars(), threaded);
+        EXPECT(words.isEstimatingUniques());
+        // four standard errors
+        double error = words.getUniquesError() * 4;
+        for (int n = 1; n <= 3; n++) {
+            EXPECT(words.total(n) == exact.total(n));
+            EXPECT(fabs((double)words.count(n) / exact.count(n) - 1) < error);
+            // the sketches of the threads merge into the same registers
+            EXPECT(threadedWords.count(n) == words.count(n));
+            EXPECT(threadedWords.total(n) == words.total(n));
+        }
+
+        HyperLogLog small(HyperLogLog::MIN_PRECISION);
+        EXPECT(small.estimate() == 0);
+        small.add(HashNgramTable::hash("a", 1));
+        small.add(HashNgramTable::hash("a", 1));
+        EXPECT(small.estimate() == 1);
+    },
+
+    CASE("tables sized up front do not grow and count the same") {
+        for (int type = Config::TST_TABLE; type <= Config::HASH_TABLE;
+             type++) {
+            for (int partitions = 1; partitions <= 3; partitions += 2) {
+                NgramTable *table = NgramTable::create(type, partitions);
+                table->reserve(5000);
+                size_t memoryUsage = table->getMemoryUsage();
+                for (int i = 0; i < 5000; i++) {
+                    string key = "key" + to_string(i);
+                    bool added;
+                    table->add(key.c_str(), key.length(), 1, added);
+                }
+                EXPECT(table->count() == 5000u);
+                // the tree still adds nodes
+                EXPECT((type == Config::TST_TABLE ||
+                        table->getMemoryUsage() == memoryUsage));
+                delete table;
+            }
+        }
+
+        string text;
+        for (int i = 0; i < 3000; i++) {
+            text += "w" + to_string(i * 7919 % 1009) + " ";
+        }
+        const char *file = writeTempFile(text.c_str());
+        NgramOptions sampled;
+        sampled.sampleUniques = true;
+        NgramOptions hinted;
+        hinted.expectedUniques = 10;
+        WordNgrams words(3, file, "");
+        WordNgrams sampledWords(3, file, "", Config::getDefaultDelimiters(),
+                                Config::getDefaultStopChars(), sampled);
+        WordNgrams hintedWords(3, file, "", Config::getDefaultDelimiters(),
+                               Config::getDefaultStopChars(), hinted);
+        for (int n = 1; n <= 3; n++) {
+            EXPECT(sampledWords.count(n) == words.count(n));
+            EXPECT(sampledWords.total(n) == words.total(n));
+            EXPECT(hintedWords.count(n) == words.count(n));
+        }
+    },
+
+    CASE("vector grows by moving its elements and works with algorithms") {
+        ngram_vector<utf8_string> strings;
+        strings.emplace_back("delta");
+        const char *buffer = strings[0].c_str();
+        for (int i = 0; i < 100; i++) {
+            strings.add(utf8_string(to_string(i).c_str()));
+        }
+        // the string buffer moved over to the grown storage
+        EXPECT(strings[0].c_str() == buffer);
+        strings.insert(strings[0], 1);
+        EXPECT(strings.count() == 102u);
+        EXPECT(strings[1] == "delta");
+        strings.removeRange(1, 11);
+        EXPECT(strings.count() == 91u);
+        EXPECT(strings[1] == "10");
+        strings.sort();
+        EXPECT(std::is_sorted(strings.begin(), strings.end()));
+        EXPECT(std::find(strings.begin(), strings.end(), "delta") ==
+               strings.end() - 1);
+
+        ngram_vector<int> numbers(3);
+        EXPECT(std::count(numbers.begin(), numbers.end(), 0) == 3);
+        for (int i = 0; i < 1000; i++) {
+            numbers.push_back(i * 7919 % 1000);
+        }
+        numbers.sort([](int a, int b) { return a > b; });
+        EXPECT(numbers[0] == 999);
+        EXPECT(numbers[999] == 0);
+        ngram_vector<int> moved(std::move(numbers));
+        EXPECT(numbers.count() == 0u);
+        EXPECT(moved.count() == 1003u);
+        numbers = moved;
+        EXPECT(std::equal(numbers.begin(), numbers.end(), moved.begin()));
+    },
+
+    CASE("ngrams sorted by threads are in the order of compareFunction") {
+        ngram_vector<INgrams::NgramToken *> tokens;
+        for (int i = 0; i < 300000; i++) {
+            // most ngrams are seen once and share their first 8 bytes
+            utf8_string ngram(("shared prefix " +
+                               to_string(i * 7919LL % 300007)).c_str());
+            int64_t frequency = i % 3 ? 1 : i * 31 % 70000;
+            INgrams::NgramValue value(2, frequency);
+            tokens.add(new INgrams::NgramToken(ngram, value));
+        }
+        ngram_vector<INgrams::NgramToken *> expected = tokens;
+        qsort(expected.data(), expected.count(), sizeof(INgrams::NgramToken *),
+              INgrams::compareFunction);
+        for (int threads = 1; threads <= 4; threads += 3) {
+            ngram_vector<INgrams::NgramToken *> sorted = tokens;
+            NgramSort::sortByFrequency(sorted, threads);
+            EXPECT(std::equal(sorted.begin(), sorted.end(), expected.begin()));
+        }
+        for (INgrams::NgramToken *token : tokens) {
+            delete token;
+        }
+    },
+
+    CASE("pruning keeps totals and flags the counts") {
+        utf8_string text;
+        char word[32];
+        // each of 3 shards checks its table after 65536 tokens
+        for (int i = 0; i < 300000; i++) {
+            sprintf(word, "w%d ", (int)(i * 7919LL % 50000));
+            text += word;
+        }
+        NgramOptions options;
+        options.maxMemory = 1 << 20;
+        const char *file = writeTempFile(text.c_str());
+        WordNgrams words(2, file, "");
+        EXPECT(words.getPrunedCount() == 0);
+        // partitioned counting does not prune, the shards are merged
+        const int configs[][2] = {{1, 1}, {3, 1}, {3, 2}};
+        for (int i = 0; i < 3; i++) {
+            options.threads = configs[i][0];
+            options.partitions = configs[i][1];
+            WordNgrams pruned(2, file, "", Config::getDefaultDelimiters(),
+                              Config::getDefaultStopChars(), options);
+            EXPECT(pruned.getPrunedCount() > 0);
+            EXPECT(pruned.total(1) == words.total(1));
+            EXPECT(pruned.total(2) == words.total(2));
+            EXPECT(pruned.count(2) < words.count(2));
+        }
+    },
+
+    CASE("ternary search tree keeps keys in order across clear") {
+        TernarySearchTree<int> tree;
+        for (int round = 0; round < 2; round++) {
+            tree.clear();
+            tree.add("banana", 1);
+            tree.add("apple", 2);
+            tree.add("band", 3);
+            EXPECT(tree.count() == 3);
+            EXPECT(*tree.getValue("band") == 3);
+            EXPECT(tree.getValue("ban") == (int *)NULL);
+            ngram_vector<size_t> sorted = tree.getSortedItemIndexes();
+            EXPECT(strcmp(tree.getKey(sorted[0]), "apple") == 0);
+            EXPECT(strcmp(tree.getKey(sorted[2]), "band") == 0);
+        }
+    },
+
+    CASE("hash and ternary search tree tables count the same") {
+        const char *text = "to be or not to be that is the question to be";
+        NgramOptions tstOptions;
+        tstOptions.tableType = Config::TST_TABLE;
+        NgramOptions hashOptions;
+        hashOptions.tableType = Config::HASH_TABLE;
+        WordNgrams tst(4, writeTempFile(text), "",
+                       Config::getDefaultDelimiters(),
+                       Config::getDefaultStopChars(), tstOptions);
+        WordNgrams hash(4, writeTempFile(text), "",
+                        Config::getDefaultDelimiters(),
+                        Config::getDefaultStopChars(), hashOptions);
+        for (int n = 1; n <= 4; n++) {
+            EXPECT(tst.total(n) == hash.total(n));
+            EXPECT(tst.count(n) == hash.count(n));
+        }
+        EXPECT(hash.count(1) == 8);
+        EXPECT(hash.count(2) == 9);
+    },
+
+    CASE("output is written to the --out file") {
+        const char *outName = "ngram_test_output.tmp";
+        WordNgrams ngrams(2, writeTempFile("a b a b"), outName);
+        ngrams.output();
+        FILE *fp = fopen(outName, "rb");
+        EXPECT(fp != nullptr);
+        char text[512] = {0};
+        size_t length = fread(text, 1, sizeof(text) - 1, fp);
+        fclose(fp);
+        remove(outName);
+        EXPECT(length > 0);
+        EXPECT(strncmp(text, "BEGIN OUTPUT\n", 13) == 0);
+        EXPECT(strstr(text, "\na_b\t2\n") != nullptr);
+        EXPECT(strstr(text, "\nb_a\t1\n") != nullptr);
+    },
+
+    CASE("--top outputs the head of the full sorted listing") {
+        // ten words seen once, ten twice and so on, so the top ngrams end
+        // within ties
+        string text;
+        for (int round = 0; round < 4; round++) {
+            for (int i = 0; i < 40; i++) {
+                if (i % 4 >= round) {
+                    text += "w" + to_string(i) + " ";
+                }
+            }
+        }
+        const char *inName = writeTempFile(text.c_str());
+        const char *outName = "ngram_test_output.tmp";
+        NgramOptions allOptions;
+        WordNgrams(2, inName, outName, Config::getDefaultDelimiters(),
+                   Config::getDefaultStopChars(), allOptions)
+            .output();
+        vector<string> all[2] = {readNgramLines(outName, 1),
+                                 readNgramLines(outName, 2)};
+        EXPECT(all[0].size() == 40u);
+
+        int tops[][2] = {{1, 0}, {5, 5}, {10, 13}, {15, 3}, {40, 0},
+                         {100, 200}};
+        for (int i = 0; i < 6; i++) {
+            NgramOptions options;
+            options.top.add(tops[i][0]);
+            if (tops[i][1] != tops[i][0]) {
+                options.top.add(tops[i][1]);
+            }
+            WordNgrams(2, inName, outName, Config::getDefaultDelimiters(),
+                       Config::getDefaultStopChars(), options)
+                .output();
+            for (int n = 1; n <= 2; n++) {
+                size_t top = (size_t)options.getTop(n);
+                if (top == 0 || top > all[n - 1].size()) {
+                    top = all[n - 1].size();
+                }
+                vector<string> head(all[n - 1].begin(),
+                                    all[n - 1].begin() + top);
+                EXPECT(readNgramLines(outName, n) == head);
+            }
+        }
+
+        // with --min-count the head of the listing of frequent ngrams
+        NgramOptions frequentOptions;
+        frequentOptions.minCount = 3;
+        WordNgrams(2, inName, outName, Config::getDefaultDelimiters(),
+                   Config::getDefaultStopChars(), frequentOptions)
+            .output();
+        vector<string> frequent = readNgramLines(outName, 1);
+        EXPECT(frequent.size() == 20u);
+        for (int top = 15; top <= 25; top += 10) {
+            NgramOptions options = frequentOptions;
+            options.top.add(top);
+            WordNgrams(2, inName, outName, Config::getDefaultDelimiters(),
+                       Config::getDefaultStopChars(), options)
+                .output();
+            vector<string> head(frequent.begin(),
+                                frequent.begin() + std::min(top, 20));
+            EXPECT(readNgramLines(outName, 1) == head);
+        }
+        remove(outName);
+    },
+
+    CASE("counting with spilled runs matches counting in memory") {
+        // the table is spilled every 65536 tokens
+        utf8_string text;
+        char word[16];
+        for (int i = 0; i < 150000; i++) {
+            sprintf(word, "w%d ", i * 7 % 1009 % (i % 13 + 1));
+            text += word;
+        }
+        const char *fileName = writeTempFile(text.c_str());
+        const int formats[] = {Config::TEXT_FORMAT, Config::BINARY_FORMAT};
+        for (int f = 0; f < 2; f++) {
+            NgramOptions options;
+            options.format = formats[f];
+            options.minCount = 2;
+            WordNgrams counted(3, fileName, "ngram_test_counted.tmp",
+                               Config::getDefaultDelimiters(),
+                               Config::getDefaultStopChars(), options);
+            options.memoryLimit = 1;
+            WordNgrams spilled(3, fileName, "ngram_test_spilled.tmp",
+                               Config::getDefaultDelimiters(),
+                               Config::getDefaultStopChars(), options);
+            for (int n = 1; n <= 3; n++) {
+                EXPECT(spilled.total(n) == counted.total(n));
+                EXPECT(spilled.count(n) == counted.count(n));
+            }
+            spilled.output();
+            counted.output();
+            FILE *fp1 = fopen("ngram_test_spilled.tmp", "rb");
+            FILE *fp2 = fopen("ngram_test_counted.tmp", "rb");
+            int c1;
+            int c2;
+            do {
+                c1 = fgetc(fp1);
+                c2 = fgetc(fp2);
+            } while (c1 == c2 && c1 != EOF);
+            EXPECT(c1 == c2);
+            fclose(fp1);
+            fclose(fp2);
+            remove("ngram_test_spilled.tmp");
+            remove("ngram_test_counted.tmp");
+        }
+    },
+
+    CASE("spilled counts add up across inputs fed in turn") {
+        // each input spills the table, and holds zzz once
+        utf8_string text;
+        char word[16];
+        for (int i = 0; i < 70000; i++) {
+            sprintf(word, "w%d ", i % 5000);
+            text += word;
+        }
+        text += "zzz ";
+        NgramOptions options;
+        options.minCount = 2;
+        WordNgrams counted(1, NULL, NULL, Config::getDefaultDelimiters(),
+                           Config::getDefaultStopChars(), options);
+        options.memoryLimit = 1;
+        WordNgrams spilled(1, NULL, NULL, Config::getDefaultDelimiters(),
+                           Config::getDefaultStopChars(), options);
+        for (int i = 0; i < 2; i++) {
+            counted.feed(text.c_str(), text.length());
+            counted.finish();
+            spilled.feed(text.c_str(), text.length());
+            spilled.finish();
+        }
+        struct Frequencies : NgramVisitor {
+            int64_t total = 0;
+            int64_t zzz = 0;
+            void visit(const char *ngram, size_t length, int n,
+                       int64_t frequency) {
+                total += frequency;
+                if (length == 3 && memcmp(ngram, "zzz", 3) == 0) {
+                    zzz = frequency;
+                }
+            }
+        } inMemory, onDisk;
+        counted.visit(inMemory, 1);
+        spilled.visit(onDisk, 1);
+        EXPECT(inMemory.zzz == 2);
+        EXPECT(onDisk.zzz == 2);
+        EXPECT(onDisk.total == inMemory.total);
+        EXPECT(spilled.count(1) == counted.count(1));
+    },
+
+    CASE("ngrams sorted in runs come back in order") {
+        // the keys fill two runs of the smallest size
+        NgramRunSorter sorter(1);
+        char key[16];
+        for (int i = 0; i < 200000; i++) {
+            int value = (int)(i * 7919LL % 200000);
+            sprintf(key, "%015d", value);
+            sorter.add(key, 15, 1, (uint64_t)value);
+        }
+        EXPECT(sorter.rewind());
+        int count = 0;
+        bool ordered = true;
+        while (sorter.next()) {
+            sprintf(key, "%015d", count);
+            ordered = ordered && sorter.getKeyLength() == 15 &&
+                      memcmp(sorter.getKey(), key, 15) == 0 &&
+                      sorter.getFrequency() == (uint64_t)count;
+            ++count;
+        }
+        EXPECT(ordered);
+        EXPECT(count == 200000);
+    },
+
+    CASE("binary ngram count file is looked up in place") {
+        const char *fileName = "ngram_test_output.ngb";
+        NgramOptions options;
+        options.format = Config::BINARY_FORMAT;
+        WordNgrams ngrams(2, writeTempFile("b a b a c"), fileName,
+                          Config::getDefaultDelimiters(),
+                          Config::getDefaultStopChars(), options);
+        ngrams.output();
+        NgramFileReader reader;
+        EXPECT(reader.open(fileName));
+        EXPECT(reader.getType() == Config::WORD_NGRAM);
+        EXPECT(reader.getN() == 2);
+        EXPECT(reader.total(1) == 5);
+        EXPECT(reader.count(2) == 3);
+        EXPECT(reader.getWordCount() == 3);
+        uint32_t id = 0;
+        EXPECT(reader.findWord("c", 1, id));
+        EXPECT(id == 2);
+        const char *ba[] = {"b", "a"};
+        const char *cb[] = {"c", "b"};
+        EXPECT(reader.getFrequency(ba, 2) == 2);
+        EXPECT(reader.getFrequency(cb, 2) == 0);
+        utf8_string ngram;
+        reader.decodeNgram(2, 0, ngram);
+        EXPECT(ngram == "a_b");
+        reader.close();
+        remove(fileName);
+    },
+
+    CASE("merging count files adds up their frequencies") {
+        NgramOptions binary;
+        binary.format = Config::BINARY_FORMAT;
+        WordNgrams text(2, writeTempFile("x_y z x_y z"), "ngram_test_1.tmp");
+        text.output();
+        WordNgrams file(2, writeTempFile("x_y z"), "ngram_test_2.tmp",
+                        Config::getDefaultDelimiters(),
+                        Config::getDefaultStopChars(), binary);
+        file.output();
+        const char *fileNames[] = {"ngram_test_1.tmp", "ngram_test_2.tmp"};
+        NgramMerger merger(binary);
+        EXPECT(merger.merge(fileNames, 2, "ngram_test_3.tmp"));
+        NgramFileReader reader;
+        EXPECT(reader.open("ngram_test_3.tmp"));
+        const char *ngram[] = {"x_y", "z"};
+        EXPECT(reader.getFrequency(ngram, 2) == 3);
+        EXPECT(reader.total(1) == 6);
+        EXPECT(reader.total(2) == 4);
+        EXPECT(reader.count(2) == 2);
+        reader.close();
+        // a negative min count keeps every ngram of sorted files
+        binary.minCount = -1;
+        const char *binaryNames[] = {"ngram_test_2.tmp", "ngram_test_2.tmp"};
+        NgramMerger sortedMerger(binary);
+        EXPECT(sortedMerger.merge(binaryNames, 2, "ngram_test_3.tmp"));
+        EXPECT(reader.open("ngram_test_3.tmp"));
+        EXPECT(reader.getKeyCount(1) == 2);
+        EXPECT(reader.getKeyCount(2) == 1);
+        reader.close();
+        remove("ngram_test_1.tmp");
+        remove("ngram_test_2.tmp");
+        remove("ngram_test_3.tmp");
+    },
+
+    CASE("binary ngram count file keeps keys of any length") {
+        const char *fileName = "ngram_test_output.ngb";
+        NgramFileWriter writer;
+        EXPECT(writer.open(fileName, Config::CHAR_NGRAM, 1));
+        writer.beginOrder(1);
+        writer.addNgram("a", 1, 1);
+        writer.addNgram("ab", 2, 1000000);
+        writer.addNgram("b", 1, 9);
+        writer.endOrder(1000010, 3);
+        EXPECT(writer.close());
+        NgramFileReader reader;
+        EXPECT(reader.open(fileName));
+        EXPECT(reader.getKeyCount(1) == 3);
+        EXPECT(reader.getFrequency(1, "ab", 2) == 1000000);
+        EXPECT(reader.getFrequency(1, "b", 1) == 9);
+        EXPECT(reader.getFrequency(1, "c", 1) == 0);
+        reader.close();
+        remove(fileName);
+    },
+
+    CASE("corrupt word ngram count files are rejected") {
+        // a word key of the wrong width fails to open
+        NgramFileWriter writer;
+        EXPECT(writer.open("ngram_test_1.tmp", Config::WORD_NGRAM, 1));
+        writer.addWord("a", 1);
+        writer.beginOrder(1);
+        writer.addNgram("abc", 3, 1);
+        writer.endOrder(1, 1);
+        EXPECT(writer.close());
+        NgramFileReader reader;
+        EXPECT_NOT(reader.open("ngram_test_1.tmp"));
+        // an unknown word id fails at lookup
+        const uint32_t ids[] = {0, 5};
+        char key[8];
+        NgramFileWriter::encodeWordKey(ids, 2, key);
+        EXPECT(writer.open("ngram_test_1.tmp", Config::WORD_NGRAM, 2));
+        writer.addWord("a", 1);
+        writer.beginOrder(1);
+        writer.addNgram(key, 4, 1);
+        writer.endOrder(1, 1);
+        writer.beginOrder(2);
+        writer.addNgram(key, 8, 1);
+        writer.endOrder(1, 1);
+        EXPECT(writer.close());
+        EXPECT(reader.open("ngram_test_1.tmp"));
+        size_t length;
+        EXPECT(reader.getWord(0, length) != (const char *)NULL);
+        EXPECT(reader.getWord(5, length) == (const char *)NULL);
+        utf8_string ngram;
+        EXPECT_NOT(reader.decodeNgram(2, 0, ngram));
+        reader.close();
+        WordNgrams words(2, NULL, "ngram_test_2.tmp");
+        EXPECT_NOT(words.load("ngram_test_1.tmp"));
+        NgramOptions binary;
+        binary.format = Config::BINARY_FORMAT;
+        const char *fileNames[] = {"ngram_test_1.tmp"};
+        NgramMerger merger(binary);
+        EXPECT_NOT(merger.merge(fileNames, 1, "ngram_test_3.tmp"));
+        remove("ngram_test_1.tmp");
+        remove("ngram_test_2.tmp");
+        remove("ngram_test_3.tmp");
+    },
+
+    CASE("frequencies and totals beyond 32 bits are counted exactly") {
+        NgramFileWriter writer;
+        EXPECT(writer.open("ngram_test_1.tmp", Config::CHAR_NGRAM, 1));
+        writer.beginOrder(1);
+        writer.addNgram("a", 1, 3000000000ULL);
+        writer.addNgram("b", 1, 2000000000ULL);
+        writer.endOrder(5000000000ULL, 2);
+        EXPECT(writer.close());
+        CharNgrams chars(1, NULL, "ngram_test_2.tmp");
+        EXPECT(chars.load("ngram_test_1.tmp"));
+        EXPECT(chars.load("ngram_test_1.tmp"));
+        EXPECT(chars.total(1) == 10000000000LL);
+        EXPECT(chars.count(1) == 2);
+        chars.output();
+        // the text output and the binary file are merged back
+        NgramOptions binary;
+        binary.format = Config::BINARY_FORMAT;
+        const char *fileNames[] = {"ngram_test_1.tmp", "ngram_test_2.tmp"};
+        NgramMerger merger(binary);
+        EXPECT(merger.merge(fileNames, 2, "ngram_test_3.tmp"));
+        NgramFileReader reader;
+        EXPECT(reader.open("ngram_test_3.tmp"));
+        EXPECT(reader.getFrequency(1, "a", 1) == 9000000000ULL);
+        EXPECT(reader.getFrequency(1, "b", 1) == 6000000000ULL);
+        EXPECT(reader.total(1) == 15000000000ULL);
+        reader.close();
+        remove("ngram_test_1.tmp");
+        remove("ngram_test_2.tmp");
+        remove("ngram_test_3.tmp");
+    },
 };
 
 int main (int argc, char *argv[]) {